@@ -1002,6 +1002,7 @@ void MergeDives::swapDivesite()
 	if (!site)
 		return;
 	std::swap(location, site->location);
+	divelog.sites.location_changed(site);
 	emit diveListNotifier.diveSiteChanged(site, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 }
 
@@ -278,6 +278,7 @@ bool EditDiveSiteLocation::workToBeDone()
 void EditDiveSiteLocation::redo()
 {
 	std::swap(value, ds->location);
+	divelog.sites.location_changed(ds);
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 }
 
@@ -384,6 +385,7 @@ ApplyGPSFixes::ApplyGPSFixes(const std::vector<DiveAndLocation> &fixes)
 		} else {
 			ds = divelog.sites.create(dl.name.toStdString());
 			ds->location = dl.location;
+			divelog.sites.location_changed(ds);
 			ds->add_dive(dl.d);
 			dl.d->dive_site = nullptr; // This will be set on redo()
 			sitesToAdd.emplace_back(ds);
@@ -400,6 +402,7 @@ void ApplyGPSFixes::editDiveSites()
 {
 	for (SiteAndLocation &sl: siteLocations) {
 		std::swap(sl.location, sl.ds->location);
+		divelog.sites.location_changed(sl.ds);
 		emit diveListNotifier.diveSiteChanged(sl.ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
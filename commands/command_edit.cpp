@@ -752,6 +752,7 @@ void PasteDives::undo()
 	for (PasteState &state: dives) {
 		divesToNotify.push_back(&state.d);
 		state.swap();
+		fulltext_register(&state.d); // Update the fulltext cache
 		state.d.invalidate_cache(); // Ensure that dive is written in git_save()
 	}
 
@@ -10,8 +10,9 @@
  *
  * add_segment()	- add <seconds> at the given pressure, breathing gasmix
  * deco_allowed_depth() - ceiling based on lead tissue, surface pressure, 3m increments or smooth
- * set_gf()		- set Buehlmann gradient factors
- * set_vpmb_conservatism() - set VPM-B conservatism value
+ * set_gf()		- set Buehlmann gradient factors of new deco states
+ * set_vpmb_conservatism() - set VPM-B conservatism value of new deco states
+ * set_vectorized_deco() - use the vectorized per-tissue kernels (default) or the scalar ones
  * clear_deco()
  * dump_tissues()
  */
@@ -28,6 +29,8 @@
 #include "planner.h"
 #include "qthelper.h"
 
+#include <mutex>
+
 #define cube(x) (x * x * x)
 
 // Subsurface until v4.6.2 appeared to produce marginally less conservative plans than our benchmarks.
@@ -40,8 +43,6 @@ struct buehlmann_config {
 	double satmult;			//! safety at inert gas accumulation as percentage of effect (more than 100).
 	double desatmult;		//! safety at inert gas depletion as percentage of effect (less than 100).
 	int last_deco_stop_in_mtr;	//! depth of last_deco_stop.
-	double gf_high;			//! gradient factor high (at surface).
-	double gf_low;			//! gradient factor low (at bottom/start of deco calculation).
 	double gf_low_position_min;	//! gf_low_position below surface_min_shallow.
 };
 
@@ -49,8 +50,6 @@ struct buehlmann_config buehlmann_config = {
 	.satmult = 1.0,
 	.desatmult = 1.0,
 	.last_deco_stop_in_mtr =  0,
-	.gf_high = 0.75,
-	.gf_low = 0.35,
 	.gf_low_position_min = 1.0,
 };
 
@@ -64,7 +63,6 @@ struct vpmb_config {
 	double skin_compression_gammaC;   //! Skin compression gammaC (N / bar = m2).
 	double regeneration_time;         //! Time needed for the bubble to regenerate to the start radius (min).
 	double other_gases_pressure;      //! Always present pressure of other gasses in tissues (bar).
-	short conservatism;		  //! VPM-B conservatism level (0-4)
 };
 
 static struct vpmb_config vpmb_config = {
@@ -76,7 +74,16 @@ static struct vpmb_config vpmb_config = {
 	.skin_compression_gammaC = 2.6040525,	// = 0.257 N/msw
 	.regeneration_time = 20160.0,
 	.other_gases_pressure = 0.1359888,
-	.conservatism = 3
+};
+
+//! Settings given to new deco_states, i.e. the preferences.
+//! Protected by a mutex, because deco_states are also created in worker
+//! threads (plot info, planner variations), while the UI changes the settings.
+static std::mutex global_deco_settings_lock;
+static struct deco_settings global_deco_settings = {
+	.gf_low = 0.35,
+	.gf_high = 0.75,
+	.vpmb_conservatism = 3,
 };
 
 static const double buehlmann_N2_a[] = { 1.1696, 1.0, 0.8618, 0.7562,
@@ -153,17 +160,91 @@ static const double vpmb_conservatism_lvls[] = { 1.0, 1.05, 1.12, 1.22, 1.35 };
 
 #define TISSUE_ARRAY_SZ sizeof(ds->tissue_n2_sat)
 
-static double get_crit_radius_He()
+/*
+ * Per-tissue kernels. Each comes in a scalar version and a vectorized version
+ * using the GCC / clang vector extensions, which the compiler maps onto
+ * SSE2 / AVX / NEON, depending on the target. The vectorized versions perform
+ * exactly the same operations in the same order as the scalar ones, so that
+ * the results are identical to the last bit (this is checked by TestDeco).
+ * Everything that depends on the order of the tissues (guiding tissue,
+ * running maxima) is done in scalar code afterwards.
+ */
+#if defined(__GNUC__)
+#define DECO_VECTORIZED 1
+#if defined(__AVX__)
+#define DECO_VECTOR_WIDTH 4
+#else
+#define DECO_VECTOR_WIDTH 2
+#endif
+typedef double deco_vec __attribute__((vector_size(DECO_VECTOR_WIDTH * sizeof(double))));
+
+static inline deco_vec load_vec(const double *p)
+{
+	deco_vec v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void store_vec(double *p, deco_vec v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline deco_vec broadcast(double d)
+{
+	deco_vec v;
+	for (int i = 0; i < DECO_VECTOR_WIDTH; i++)
+		v[i] = d;
+	return v;
+}
+#endif
+
+static bool vectorized_deco = true;
+
+void set_vectorized_deco(bool enable)
+{
+	vectorized_deco = enable;
+}
+
+/* Load (or unload) all tissues with the given inspired pressure of an inert gas. */
+static void load_tissues(double tissue_sat[16], double inspired, const double f[16], double satmult, double desatmult)
 {
-	if (vpmb_config.conservatism <= 4)
-		return vpmb_config.crit_radius_He * vpmb_conservatism_lvls[vpmb_config.conservatism] * subsurface_conservatism_factor;
+#if DECO_VECTORIZED
+	if (vectorized_deco) {
+		const deco_vec zero = broadcast(0.0);
+		const deco_vec vinspired = broadcast(inspired);
+		const deco_vec vsatmult = broadcast(satmult);
+		const deco_vec vdesatmult = broadcast(desatmult);
+		for (int ci = 0; ci < 16; ci += DECO_VECTOR_WIDTH) {
+			deco_vec sat = load_vec(tissue_sat + ci);
+			deco_vec oversat = vinspired - sat;
+			deco_vec mult = oversat > zero ? vsatmult : vdesatmult;
+			sat += mult * oversat * load_vec(f + ci);
+			store_vec(tissue_sat + ci, sat);
+		}
+		return;
+	}
+#endif
+	for (int ci = 0; ci < 16; ci++) {
+		double oversat = inspired - tissue_sat[ci];
+		double mult = oversat > 0 ? satmult : desatmult;
+		tissue_sat[ci] += mult * oversat * f[ci];
+	}
+}
+
+static double get_crit_radius_He(const struct deco_state *ds)
+{
+	short conservatism = ds->settings.vpmb_conservatism;
+	if (conservatism <= 4)
+		return vpmb_config.crit_radius_He * vpmb_conservatism_lvls[conservatism] * subsurface_conservatism_factor;
 	return vpmb_config.crit_radius_He;
 }
 
-static double get_crit_radius_N2()
+static double get_crit_radius_N2(const struct deco_state *ds)
 {
-	if (vpmb_config.conservatism <= 4)
-		return vpmb_config.crit_radius_N2 * vpmb_conservatism_lvls[vpmb_config.conservatism] * subsurface_conservatism_factor;
+	short conservatism = ds->settings.vpmb_conservatism;
+	if (conservatism <= 4)
+		return vpmb_config.crit_radius_N2 * vpmb_conservatism_lvls[conservatism] * subsurface_conservatism_factor;
 	return vpmb_config.crit_radius_N2;
 }
 
@@ -215,44 +296,126 @@ static double vpmb_tolerated_ambient_pressure(struct deco_state *ds, double refe
 	return ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci] + vpmb_config.other_gases_pressure - total_gradient;
 }
 
+/* Calculate the Bühlmann a and b coefficients of all tissues for the current mix of inert gases. */
+static void buehlmann_coefficients(struct deco_state *ds)
+{
+#if DECO_VECTORIZED
+	if (vectorized_deco) {
+		for (int ci = 0; ci < 16; ci += DECO_VECTOR_WIDTH) {
+			deco_vec n2_sat = load_vec(ds->tissue_n2_sat + ci);
+			deco_vec he_sat = load_vec(ds->tissue_he_sat + ci);
+			deco_vec sat = load_vec(ds->tissue_inertgas_saturation + ci);
+			store_vec(ds->buehlmann_inertgas_a + ci, ((load_vec(buehlmann_N2_a + ci) * n2_sat) + (load_vec(buehlmann_He_a + ci) * he_sat)) / sat);
+			store_vec(ds->buehlmann_inertgas_b + ci, ((load_vec(buehlmann_N2_b + ci) * n2_sat) + (load_vec(buehlmann_He_b + ci) * he_sat)) / sat);
+		}
+		return;
+	}
+#endif
+	for (int ci = 0; ci < 16; ci++) {
+		ds->buehlmann_inertgas_a[ci] = ((buehlmann_N2_a[ci] * ds->tissue_n2_sat[ci]) + (buehlmann_He_a[ci] * ds->tissue_he_sat[ci])) / ds->tissue_inertgas_saturation[ci];
+		ds->buehlmann_inertgas_b[ci] = ((buehlmann_N2_b[ci] * ds->tissue_n2_sat[ci]) + (buehlmann_He_b[ci] * ds->tissue_he_sat[ci])) / ds->tissue_inertgas_saturation[ci];
+	}
+}
+
+/* The ambient pressure each tissue tolerates at gf_low. */
+static void buehlmann_lowest_ceilings(const struct deco_state *ds, double gf_low, double lowest_ceiling[16])
+{
+#if DECO_VECTORIZED
+	if (vectorized_deco) {
+		const deco_vec vgf_low = broadcast(gf_low);
+		const deco_vec one = broadcast(1.0);
+		for (int ci = 0; ci < 16; ci += DECO_VECTOR_WIDTH) {
+			deco_vec a = load_vec(ds->buehlmann_inertgas_a + ci);
+			deco_vec b = load_vec(ds->buehlmann_inertgas_b + ci);
+			deco_vec sat = load_vec(ds->tissue_inertgas_saturation + ci);
+			store_vec(lowest_ceiling + ci, (b * sat - vgf_low * a * b) / ((one - b) * vgf_low + b));
+		}
+		return;
+	}
+#endif
+	for (int ci = 0; ci < 16; ci++) {
+		/* tolerated = (tissue_inertgas_saturation - buehlmann_inertgas_a) * buehlmann_inertgas_b; */
+		lowest_ceiling[ci] = (ds->buehlmann_inertgas_b[ci] * ds->tissue_inertgas_saturation[ci] - gf_low * ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci]) /
+				     ((1.0 - ds->buehlmann_inertgas_b[ci]) * gf_low + ds->buehlmann_inertgas_b[ci]);
+	}
+}
+
+/*
+ * The ambient pressure each tissue tolerates with the gradient factor interpolated between
+ * gf_low (at gf_low_pressure_this_dive) and gf_high (at the surface). use_tolerated[ci] is
+ * set to 0.0 for tissues where this doesn't apply.
+ */
+static void buehlmann_tolerated(const struct deco_state *ds, double gf_low, double gf_high, double surface,
+				double tolerated[16], double use_tolerated[16])
+{
+	const double gf_low_pressure = ds->gf_low_pressure_this_dive;
+	const double k1 = gf_high * gf_low_pressure - gf_low * surface;
+	const double k2 = gf_high - gf_low;
+	const double k3 = gf_low_pressure - surface;
+	const double k4 = gf_low * gf_low_pressure - gf_high * surface;
+#if DECO_VECTORIZED
+	if (vectorized_deco) {
+		const deco_vec vgf_low = broadcast(gf_low);
+		const deco_vec vgf_high = broadcast(gf_high);
+		const deco_vec vsurface = broadcast(surface);
+		const deco_vec vgf_low_pressure = broadcast(gf_low_pressure);
+		const deco_vec vk1 = broadcast(k1);
+		const deco_vec vk2 = broadcast(k2);
+		const deco_vec vk3 = broadcast(k3);
+		const deco_vec vk4 = broadcast(k4);
+		const deco_vec zero = broadcast(0.0);
+		const deco_vec one = broadcast(1.0);
+		for (int ci = 0; ci < 16; ci += DECO_VECTOR_WIDTH) {
+			deco_vec a = load_vec(ds->buehlmann_inertgas_a + ci);
+			deco_vec b = load_vec(ds->buehlmann_inertgas_b + ci);
+			deco_vec sat = load_vec(ds->tissue_inertgas_saturation + ci);
+			deco_vec use = (vsurface / b + a - vsurface) * vgf_high + vsurface <
+				       (vgf_low_pressure / b + a - vgf_low_pressure) * vgf_low + vgf_low_pressure ? one : zero;
+			store_vec(use_tolerated + ci, use);
+			store_vec(tolerated + ci, (-a * b * vk1 - (one - b) * vk2 * vgf_low_pressure * vsurface + b * vk3 * sat) /
+						  (-a * b * vk2 + (one - b) * vk4 + b * vk3));
+		}
+		return;
+	}
+#endif
+	for (int ci = 0; ci < 16; ci++) {
+		double a = ds->buehlmann_inertgas_a[ci];
+		double b = ds->buehlmann_inertgas_b[ci];
+		double sat = ds->tissue_inertgas_saturation[ci];
+		use_tolerated[ci] = (surface / b + a - surface) * gf_high + surface <
+				    (gf_low_pressure / b + a - gf_low_pressure) * gf_low + gf_low_pressure ? 1.0 : 0.0;
+		tolerated[ci] = (-a * b * k1 - (1.0 - b) * k2 * gf_low_pressure * surface + b * k3 * sat) /
+				(-a * b * k2 + (1.0 - b) * k4 + b * k3);
+	}
+}
+
 double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, double pressure, bool in_planner)
 {
 	int ci = -1;
 	double ret_tolerance_limit_ambient_pressure = 0.0;
-	double gf_high = buehlmann_config.gf_high;
-	double gf_low = buehlmann_config.gf_low;
+	double gf_high = ds->settings.gf_high;
+	double gf_low = ds->settings.gf_low;
 	double surface = dive->get_surface_pressure().mbar / 1000.0;
 	double lowest_ceiling = 0.0;
 	double tissue_lowest_ceiling[16];
+	double tissue_tolerated[16], use_tissue_tolerated[16];
 
-	for (ci = 0; ci < 16; ci++) {
-		ds->buehlmann_inertgas_a[ci] = ((buehlmann_N2_a[ci] * ds->tissue_n2_sat[ci]) + (buehlmann_He_a[ci] * ds->tissue_he_sat[ci])) / ds->tissue_inertgas_saturation[ci];
-		ds->buehlmann_inertgas_b[ci] = ((buehlmann_N2_b[ci] * ds->tissue_n2_sat[ci]) + (buehlmann_He_b[ci] * ds->tissue_he_sat[ci])) / ds->tissue_inertgas_saturation[ci];
-	}
+	buehlmann_coefficients(ds);
 
 	if (decoMode(in_planner) != VPMB) {
+		buehlmann_lowest_ceilings(ds, gf_low, tissue_lowest_ceiling);
 		for (ci = 0; ci < 16; ci++) {
-
-			/* tolerated = (tissue_inertgas_saturation - buehlmann_inertgas_a) * buehlmann_inertgas_b; */
-
-			tissue_lowest_ceiling[ci] = (ds->buehlmann_inertgas_b[ci] * ds->tissue_inertgas_saturation[ci] - gf_low * ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci]) /
-						     ((1.0 - ds->buehlmann_inertgas_b[ci]) * gf_low + ds->buehlmann_inertgas_b[ci]);
 			if (tissue_lowest_ceiling[ci] > lowest_ceiling)
 				lowest_ceiling = tissue_lowest_ceiling[ci];
 			if (lowest_ceiling > ds->gf_low_pressure_this_dive)
 				ds->gf_low_pressure_this_dive = lowest_ceiling;
 		}
+		buehlmann_tolerated(ds, gf_low, gf_high, surface, tissue_tolerated, use_tissue_tolerated);
 		for (ci = 0; ci < 16; ci++) {
 			double tolerated;
 
-			if ((surface / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - surface) * gf_high + surface <
-			    (ds->gf_low_pressure_this_dive / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - ds->gf_low_pressure_this_dive) * gf_low + ds->gf_low_pressure_this_dive)
-				tolerated = (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high * ds->gf_low_pressure_this_dive - gf_low * surface) -
-					     (1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_high - gf_low) * ds->gf_low_pressure_this_dive * surface +
-					     ds->buehlmann_inertgas_b[ci] * (ds->gf_low_pressure_this_dive - surface) * ds->tissue_inertgas_saturation[ci]) /
-					    (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high - gf_low) +
-					     (1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_low * ds->gf_low_pressure_this_dive - gf_high * surface) +
-					     ds->buehlmann_inertgas_b[ci] * (ds->gf_low_pressure_this_dive - surface));
+			if (use_tissue_tolerated[ci] != 0.0)
+				tolerated = tissue_tolerated[ci];
 			else
 				tolerated = ret_tolerance_limit_ambient_pressure;
 
@@ -306,6 +469,49 @@ static double factor(int period_in_seconds, int ci, enum gas_component gas)
 		return 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_He_t_halflife[ci]);
 }
 
+/*
+ * The Buehlmann factors of all tissues for a given period. The profile and the
+ * planner use only a handful of different periods (sample intervals, planner time
+ * steps, ascent steps), often alternating between them. Therefore, keep a small
+ * table of the most recently used periods instead of calling exp() 32 times for
+ * every segment. The factors do not depend on the gradient factors or the
+ * conservatism, so the table never has to be invalidated. It is thread local,
+ * so that concurrent deco calculations don't have to synchronize.
+ */
+#define FACTOR_CACHE_SIZE 8
+
+struct deco_factors {
+	int period_in_seconds = 0;
+	unsigned int last_used = 0;
+	double n2[16];
+	double he[16];
+};
+
+static const struct deco_factors &factors(int period_in_seconds)
+{
+	thread_local struct deco_factors cache[FACTOR_CACHE_SIZE];
+	thread_local unsigned int use_counter = 0;
+	struct deco_factors *oldest = &cache[0];
+
+	++use_counter;
+	for (struct deco_factors &entry: cache) {
+		if (entry.last_used && entry.period_in_seconds == period_in_seconds) {
+			entry.last_used = use_counter;
+			return entry;
+		}
+		if (entry.last_used < oldest->last_used)
+			oldest = &entry;
+	}
+
+	oldest->period_in_seconds = period_in_seconds;
+	oldest->last_used = use_counter;
+	for (int ci = 0; ci < 16; ci++) {
+		oldest->n2[ci] = factor(period_in_seconds, ci, N2);
+		oldest->he[ci] = factor(period_in_seconds, ci, HE);
+	}
+	return *oldest;
+}
+
 static double calc_surface_phase(double surface_pressure, double he_pressure, double n2_pressure, double he_time_constant, double n2_time_constant, bool in_planner)
 {
 	double inspired_n2 = (surface_pressure - ((in_planner && (decoMode(true) == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE)) * NITROGEN_FRACTION;
@@ -385,11 +591,11 @@ void nuclear_regeneration(struct deco_state *ds, double time)
 	double crushing_radius_N2, crushing_radius_He;
 	for (ci = 0; ci < 16; ++ci) {
 		//rm
-		crushing_radius_N2 = 1.0 / (ds->max_n2_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_N2());
-		crushing_radius_He = 1.0 / (ds->max_he_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_He());
+		crushing_radius_N2 = 1.0 / (ds->max_n2_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_N2(ds));
+		crushing_radius_He = 1.0 / (ds->max_he_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_He(ds));
 		//rs
-		ds->n2_regen_radius[ci] = crushing_radius_N2 + (get_crit_radius_N2() - crushing_radius_N2) * (1.0 - exp (-time / vpmb_config.regeneration_time));
-		ds->he_regen_radius[ci] = crushing_radius_He + (get_crit_radius_He() - crushing_radius_He) * (1.0 - exp (-time / vpmb_config.regeneration_time));
+		ds->n2_regen_radius[ci] = crushing_radius_N2 + (get_crit_radius_N2(ds) - crushing_radius_N2) * (1.0 - exp (-time / vpmb_config.regeneration_time));
+		ds->he_regen_radius[ci] = crushing_radius_He + (get_crit_radius_He(ds) - crushing_radius_He) * (1.0 - exp (-time / vpmb_config.regeneration_time));
 	}
 }
 
@@ -429,8 +635,8 @@ void calc_crushing_pressure(struct deco_state *ds, double pressure)
 			if (ds->max_ambient_pressure >= pressure)
 				return;
 
-			n2_inner_pressure = calc_inner_pressure(get_crit_radius_N2(), ds->crushing_onset_tension[ci], pressure);
-			he_inner_pressure = calc_inner_pressure(get_crit_radius_He(), ds->crushing_onset_tension[ci], pressure);
+			n2_inner_pressure = calc_inner_pressure(get_crit_radius_N2(ds), ds->crushing_onset_tension[ci], pressure);
+			he_inner_pressure = calc_inner_pressure(get_crit_radius_He(ds), ds->crushing_onset_tension[ci], pressure);
 
 			n2_crushing_pressure = pressure - n2_inner_pressure;
 			he_crushing_pressure = pressure - he_inner_pressure;
@@ -446,27 +652,29 @@ void add_segment(struct deco_state *ds, double pressure, struct gasmix gasmix, i
 {
 	int ci;
 	bool icd = false;
+	const struct deco_factors &f = factors(period_in_seconds);
+	const double *n2_f = f.n2;
+	const double *he_f = f.he;
 	gas_pressures pressures = fill_pressures(pressure - ((in_planner && (decoMode(true) == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE),
 		       gasmix, (double) ccpo2 / 1000.0, divemode);
 
-	for (ci = 0; ci < 16; ci++) {
+	// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
+	ci = ds->ci_pointing_to_guiding_tissue;
+	if (ci >= 0 && ci < 16) {
 		double pn2_oversat = pressures.n2 - ds->tissue_n2_sat[ci];
 		double phe_oversat = pressures.he - ds->tissue_he_sat[ci];
-		double n2_f = factor(period_in_seconds, ci, N2);
-		double he_f = factor(period_in_seconds, ci, HE);
 		double n2_satmult = pn2_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
 		double he_satmult = phe_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
 
-		// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
-		if (ci == ds->ci_pointing_to_guiding_tissue && pn2_oversat > 0.0 && phe_oversat < 0.0 &&
-		    pn2_oversat * n2_satmult * n2_f + phe_oversat * he_satmult * he_f > 0)
+		if (pn2_oversat > 0.0 && phe_oversat < 0.0 &&
+		    pn2_oversat * n2_satmult * n2_f[ci] + phe_oversat * he_satmult * he_f[ci] > 0)
 			icd = true;
+	}
 
-		ds->tissue_n2_sat[ci] += n2_satmult * pn2_oversat * n2_f;
-		ds->tissue_he_sat[ci] += he_satmult * phe_oversat * he_f;
+	load_tissues(ds->tissue_n2_sat, pressures.n2, n2_f, buehlmann_config.satmult, buehlmann_config.desatmult);
+	load_tissues(ds->tissue_he_sat, pressures.he, he_f, buehlmann_config.satmult, buehlmann_config.desatmult);
+	for (ci = 0; ci < 16; ci++)
 		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
-
-	}
 	if (decoMode(in_planner) == VPMB)
 		calc_crushing_pressure(ds, pressure);
 	ds->icd_warning = icd;
@@ -503,15 +711,17 @@ void clear_deco(struct deco_state *ds, double surface_pressure, bool in_planner)
 {
 	int ci;
 
+	struct deco_settings settings = ds->settings;
 	*ds = deco_state();
+	ds->settings = settings;
 	clear_vpmb_state(ds);
 	for (ci = 0; ci < 16; ci++) {
 		ds->tissue_n2_sat[ci] = (surface_pressure - ((in_planner && (decoMode(true) == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE)) * N2_IN_AIR / 1000;
 		ds->tissue_he_sat[ci] = 0.0;
 		ds->max_n2_crushing_pressure[ci] = 0.0;
 		ds->max_he_crushing_pressure[ci] = 0.0;
-		ds->n2_regen_radius[ci] = get_crit_radius_N2();
-		ds->he_regen_radius[ci] = get_crit_radius_He();
+		ds->n2_regen_radius[ci] = get_crit_radius_N2(ds);
+		ds->he_regen_radius[ci] = get_crit_radius_He(ds);
 	}
 	ds->gf_low_pressure_this_dive = surface_pressure + buehlmann_config.gf_low_position_min;
 	ds->max_ambient_pressure = 0.0;
@@ -562,29 +772,47 @@ int deco_allowed_depth(double tissues_tolerance, double surface_pressure, const
 	return depth;
 }
 
-void set_gf(short gflow, short gfhigh)
+void deco_settings::set_gf(short gflow, short gfhigh)
 {
 	if (gflow != -1)
-		buehlmann_config.gf_low = (double)gflow / 100.0;
+		gf_low = (double)gflow / 100.0;
 	if (gfhigh != -1)
-		buehlmann_config.gf_high = (double)gfhigh / 100.0;
+		gf_high = (double)gfhigh / 100.0;
 }
 
-void set_vpmb_conservatism(short conservatism)
+void deco_settings::set_vpmb_conservatism(short conservatism)
 {
 	if (conservatism < 0)
-		vpmb_config.conservatism = 0;
+		vpmb_conservatism = 0;
 	else if (conservatism > 4)
-		vpmb_config.conservatism = 4;
+		vpmb_conservatism = 4;
 	else
-		vpmb_config.conservatism = conservatism;
+		vpmb_conservatism = conservatism;
+}
+
+struct deco_settings default_deco_settings()
+{
+	std::lock_guard<std::mutex> lock(global_deco_settings_lock);
+	return global_deco_settings;
+}
+
+void set_gf(short gflow, short gfhigh)
+{
+	std::lock_guard<std::mutex> lock(global_deco_settings_lock);
+	global_deco_settings.set_gf(gflow, gfhigh);
+}
+
+void set_vpmb_conservatism(short conservatism)
+{
+	std::lock_guard<std::mutex> lock(global_deco_settings_lock);
+	global_deco_settings.set_vpmb_conservatism(conservatism);
 }
 
 double get_gf(struct deco_state *ds, double ambpressure_bar, const struct dive *dive)
 {
 	double surface_pressure_bar = dive->get_surface_pressure().mbar / 1000.0;
-	double gf_low = buehlmann_config.gf_low;
-	double gf_high = buehlmann_config.gf_high;
+	double gf_low = ds->settings.gf_low;
+	double gf_high = ds->settings.gf_high;
 	double gf;
 	if (ds->gf_low_pressure_this_dive > surface_pressure_bar)
 		gf = std::max((double)gf_low, (ambpressure_bar - surface_pressure_bar) /
@@ -11,7 +11,25 @@ struct dive;
 struct divecomputer;
 struct decostop;
 
+/* Settings of the decompression model. Every deco_state carries its own copy,
+ * so that calculations with different settings (e.g. the planner and its
+ * variations) don't have to modify global state and can run concurrently. */
+struct deco_settings {
+	double gf_low;			// gradient factor low (at bottom/start of deco calculation)
+	double gf_high;			// gradient factor high (at surface)
+	short vpmb_conservatism;	// VPM-B conservatism level (0-4)
+
+	void set_gf(short gflow, short gfhigh);
+	void set_vpmb_conservatism(short conservatism);
+};
+
+// The settings set by set_gf() and set_vpmb_conservatism(), i.e. the preferences.
+// May be called from any thread.
+extern struct deco_settings default_deco_settings();
+
 struct deco_state {
+	struct deco_settings settings = default_deco_settings();
+
 	double tissue_n2_sat[16] = {};
 	double tissue_he_sat[16] = {};
 	double tolerated_by_tissue[16] = {};
@@ -53,6 +71,7 @@ extern void clear_deco(struct deco_state *ds, double surface_pressure, bool in_p
 extern void dump_tissues(struct deco_state *ds);
 extern void set_gf(short gflow, short gfhigh);
 extern void set_vpmb_conservatism(short conservatism);
+extern void set_vectorized_deco(bool enable);
 extern void nuclear_regeneration(struct deco_state *ds, double time);
 extern void vpmb_start_gradient(struct deco_state *ds);
 extern void vpmb_next_gradient(struct deco_state *ds, double deco_time, double surface_pressure, bool in_planner);
@@ -172,6 +172,7 @@ extern std::unique_ptr<dive> clone_make_first_dc(const struct dive &d, int dc_nu
 
 extern int save_dives(const char *filename);
 extern int save_dives_logic(const char *filename, bool select_only, bool anonymize);
+extern void set_xml_parallel_save(bool enable);
 extern int save_dive(FILE *f, const struct dive &dive, bool anonymize);
 extern int export_dives_xslt(const char *filename, bool selected, const int units, const char *export_xslt, bool anonymize);
 
@@ -4,6 +4,8 @@
 
 #include "divemode.h"
 #include "units.h"
+#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -43,6 +45,10 @@ struct divecomputer {
 	std::vector<struct sample> samples;
 	std::vector<struct event> events;
 	std::vector<struct extra_data> extra_data;
+	// The git blob this dive computer was last loaded from or saved to and
+	// a hash of the data it was written from. See save-git.cpp.
+	std::array<unsigned char, 20> git_id = {};
+	uint64_t git_hash = 0;
 
 	divecomputer();
 	~divecomputer();
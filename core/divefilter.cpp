@@ -61,10 +61,12 @@ ShownChange DiveFilter::update(const QVector<dive *> &dives) const
 	std::vector<dive *> selection = getDiveSelection();
 	std::vector<dive *> removeFromSelection;
 	for (dive *d: dives) {
+		// Always evaluate the constraints, since that updates the cached results of edited dives
+		bool show = showDive(d);
 		// There are three modes: divesite, fulltext, normal
 		bool newStatus = doDS        ? range_contains(dive_sites, d->dive_site) :
-				 doFullText  ? fulltext_dive_matches(d, filterData.fullText, filterData.fulltextStringMode) && showDive(d) :
-					       showDive(d);
+				 doFullText  ? fulltext_dive_matches(d, filterData.fullText, filterData.fulltextStringMode) && show :
+					       show;
 		updateDiveStatus(d, newStatus, res, removeFromSelection);
 	}
 	updateSelection(selection, std::vector<dive *>(), removeFromSelection);
@@ -80,6 +82,11 @@ void DiveFilter::reset()
 	updateAll();
 }
 
+static bool hiddenInvalid(const struct dive *d)
+{
+	return d->invalid && !prefs.display_invalid_dives;
+}
+
 ShownChange DiveFilter::updateAll() const
 {
 	ShownChange res;
@@ -91,16 +98,16 @@ ShownChange DiveFilter::updateAll() const
 			bool newStatus = range_contains(dive_sites, d->dive_site);
 			updateDiveStatus(d.get(), newStatus, res, removeFromSelection);
 		}
-	} else if (filterData.fullText.doit()) {
-		FullTextResult ft = fulltext_find_dives(filterData.fullText, filterData.fulltextStringMode);
-		for (auto &d: divelog.dives) {
-			bool newStatus = ft.dive_matches(d.get()) && showDive(d.get());
-			updateDiveStatus(d.get(), newStatus, res, removeFromSelection);
-		}
 	} else {
-		for (auto &d: divelog.dives) {
-			bool newStatus = showDive(d.get());
-			updateDiveStatus(d.get(), newStatus, res, removeFromSelection);
+		bool doFullText = filterData.fullText.doit();
+		FullTextResult ft;
+		if (doFullText)
+			ft = fulltext_find_dives(filterData.fullText, filterData.fulltextStringMode);
+		std::vector<uint64_t> matches = constraintCache.matches(filterData.constraints);
+		for (size_t i = 0; i < divelog.dives.size(); ++i) {
+			dive *d = divelog.dives[i].get();
+			bool newStatus = (!doFullText || ft.dive_matches(d)) && !hiddenInvalid(d) && FilterConstraintCache::testBit(matches, i);
+			updateDiveStatus(d, newStatus, res, removeFromSelection);
 		}
 	}
 	updateSelection(selection, std::vector<dive *>(), removeFromSelection);
@@ -128,14 +135,14 @@ void DiveFilter::diveRemoved(const dive *d) const
 
 bool DiveFilter::showDive(const struct dive *d) const
 {
-	if (d->invalid && !prefs.display_invalid_dives)
-		return false;
-
-	if (!filterData.validFilter())
-		return true;
+	// Evaluate the constraints first, so that the cache is also updated for invalid dives
+	bool matches = matchConstraints(d);
+	return !hiddenInvalid(d) && matches;
+}
 
-	return std::all_of(filterData.constraints.begin(), filterData.constraints.end(),
-			   [d] (const filter_constraint &c) { return filter_constraint_match_dive(c, d); });
+bool DiveFilter::matchConstraints(const struct dive *d) const
+{
+	return constraintCache.matchDive(filterData.constraints, d);
 }
 
 #if !defined(SUBSURFACE_MOBILE) && !defined(SUBSURFACE_DOWNLOADER)
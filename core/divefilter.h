@@ -5,6 +5,7 @@
 
 #include "fulltext.h"
 #include "filterconstraint.h"
+#include "filterconstraintcache.h"
 #include <vector>
 #include <QVector>
 #include <QStringList>
@@ -57,6 +58,7 @@ public:
 private:
 	DiveFilter();
 	bool showDive(const struct dive *d) const; // Should that dive be shown?
+	bool matchConstraints(const struct dive *d) const; // Also updates the cached results of the dive
 	bool setFilterStatus(struct dive *d, bool shown,
 			     std::vector<dive *> &removeFromSelection) const;
 	void updateDiveStatus(dive *d, bool newStatus, ShownChange &change,
@@ -66,6 +68,8 @@ private:
 	FilterData filterData;
 	mutable int shown_dives;
 
+	mutable FilterConstraintCache constraintCache;
+
 	// We use ref-counting for the dive site mode. The reason is that when switching
 	// between two tabs that both need dive site mode, the following course of
 	// events may happen:
@@ -3,6 +3,7 @@
 
 #include "divelist.h"
 #include "subsurface-string.h"
+#include "subsurface-hash.h"
 #include "deco.h"
 #include "device.h"
 #include "dive.h"
@@ -24,6 +25,7 @@
 #include "version.h"
 
 #include <time.h>
+#include <mutex>
 
 void dive_table::record_dive(std::unique_ptr<dive> d)
 {
@@ -438,23 +440,98 @@ static void add_dive_to_deco(struct deco_state *ds, const struct dive &dive, boo
 	}
 }
 
-/* take into account previous dives until there is a 48h gap between dives */
-/* return last surface time before this dive or dummy value of 48h */
-/* return negative surface time if dives are overlapping */
-/* The place you call this function is likely the place where you want
- * to create the deco_state */
-int dive_table::init_decompression(struct deco_state *ds, const struct dive *dive, bool in_planner) const
+/*
+ * Cache of the deco states at the end of previous dives. Without it, opening
+ * a dive late in a series of repetitive dives replays all the previous dives
+ * second by second. The key is a hash over the dive, all the dives before it
+ * that went into the calculation, and the deco settings. Thus, when a dive is
+ * changed, the entries of it and of all later dives are not found anymore and
+ * eventually evicted. Protected by a mutex, because plans are computed in
+ * worker threads.
+ */
+#define END_OF_DIVE_CACHE_SIZE 64
+
+struct end_of_dive_state {
+	uint64_t key;
+	unsigned int last_used;
+	struct deco_state ds;
+};
+
+static std::mutex end_of_dive_lock;
+static std::vector<end_of_dive_state> end_of_dive_states;
+static unsigned int end_of_dive_clock;
+
+static bool get_end_of_dive_state(uint64_t key, struct deco_state *ds)
 {
-	int surface_time = 48 * 60 * 60;
-	timestamp_t last_endtime = 0, last_starttime = 0;
-	bool deco_init = false;
-	double surface_pressure;
+	std::lock_guard<std::mutex> lock(end_of_dive_lock);
+	for (end_of_dive_state &entry: end_of_dive_states) {
+		if (entry.key == key) {
+			entry.last_used = ++end_of_dive_clock;
+			*ds = entry.ds;
+			return true;
+		}
+	}
+	return false;
+}
 
-	if (!dive)
-		return false;
+static void put_end_of_dive_state(uint64_t key, const struct deco_state *ds)
+{
+	std::lock_guard<std::mutex> lock(end_of_dive_lock);
+	if (end_of_dive_states.size() < END_OF_DIVE_CACHE_SIZE) {
+		end_of_dive_states.push_back({ key, ++end_of_dive_clock, *ds });
+		return;
+	}
+	auto oldest = std::min_element(end_of_dive_states.begin(), end_of_dive_states.end(),
+				       [](const end_of_dive_state &e1, const end_of_dive_state &e2)
+				       { return e1.last_used < e2.last_used; });
+	*oldest = { key, ++end_of_dive_clock, *ds };
+}
 
+/* Hash of everything add_dive_to_deco() and the surface interval before the dive depend on */
+static uint64_t hash_dive_for_deco(uint64_t hash, const struct dive &dive)
+{
+	const struct divecomputer &dc = dive.dcs[0];
+
+	hash = hash_value(hash, dive.id);
+	hash = hash_value(hash, static_cast<uint64_t>(dive.when));
+	hash = hash_value(hash, static_cast<uint64_t>(dive.endtime()));
+	hash = hash_value(hash, dive.depth_to_bar(0));
+	hash = hash_value(hash, dive.depth_to_bar(10000)); // depends on salinity
+	hash = hash_value(hash, dive.sac);
+	hash = hash_value(hash, (int)dc.divemode);
+	for (const cylinder_t &cyl: dive.cylinders) {
+		hash = hash_value(hash, cyl.gasmix.o2.permille);
+		hash = hash_value(hash, cyl.gasmix.he.permille);
+	}
+	for (const struct event &ev: dc.events) {
+		hash = hash_value(hash, ev.time.seconds);
+		hash = hash_value(hash, ev.type);
+		hash = hash_value(hash, ev.flags);
+		hash = hash_value(hash, ev.value);
+		for (char c: ev.name)
+			hash = hash_value(hash, (int)c);
+		if (ev.is_gaschange()) {
+			hash = hash_value(hash, ev.gas.index);
+			hash = hash_value(hash, ev.gas.mix.o2.permille);
+			hash = hash_value(hash, ev.gas.mix.he.permille);
+		} else if (ev.is_divemodechange()) {
+			hash = hash_value(hash, (int)ev.divemode);
+		}
+	}
+	for (const struct sample &sample: dc.samples) {
+		hash = hash_value(hash, sample.time.seconds);
+		hash = hash_value(hash, sample.depth.mm);
+		hash = hash_value(hash, sample.setpoint.mbar);
+	}
+	return hash;
+}
+
+/* The index of the first dive that has to be considered for the tissue loading
+ * before the given dive, i.e. until there is a 48h gap between dives. divenr is
+ * the index of the dive in the table or std::string::npos. */
+int dive_table::deco_chain_start(const struct dive *dive, size_t divenr) const
+{
 	int nr_dives = static_cast<int>(size());
-	size_t divenr = get_idx(dive);
 	int i = divenr != std::string::npos ? static_cast<int>(divenr)
 					    : nr_dives;
 #if DECO_CALC_DEBUG & 2
@@ -478,7 +555,7 @@ int dive_table::init_decompression(struct deco_state *ds, const struct dive *div
 #if DECO_CALC_DEBUG & 2
 	printf("Dive number corrected to #%d\n", i);
 #endif
-	last_starttime = dive->when;
+	timestamp_t last_starttime = dive->when;
 	/* Walk backwards to check previous dives - how far do we need to go back? */
 	while (i--) {
 		if (static_cast<size_t>(i) == divenr && i > 0)
@@ -506,6 +583,65 @@ int dive_table::init_decompression(struct deco_state *ds, const struct dive *div
 		printf("Yes\n");
 #endif
 	}
+	return i + 1;
+}
+
+/* The trip and dive site may be freed while the copy lives in a worker
+ * thread. The trip filtering is done when taking the snapshot. */
+static std::unique_ptr<dive> snapshot_dive(const struct dive &d)
+{
+	auto res = std::make_unique<struct dive>(d);
+	res->divetrip = nullptr;
+	res->dive_site = nullptr;
+	return res;
+}
+
+/*
+ * Copies of the given dive and of all dives that init_decompression() looks at
+ * for it. Calling init_decompression() on the copies gives the same result as
+ * on this table, but doesn't race with changes to the dive list. Thus, the
+ * profile of the dive can be calculated in a worker thread.
+ */
+dive_table dive_table::deco_snapshot(const struct dive &dive) const
+{
+	dive_table res;
+	int nr_dives = static_cast<int>(size());
+	size_t divenr = get_idx(&dive);
+	for (int i = deco_chain_start(&dive, divenr); i < nr_dives && (*this)[i]->when < dive.when; i++) {
+		const struct dive &pdive = *(*this)[i];
+		if (static_cast<size_t>(i) == divenr || (dive.divetrip && pdive.divetrip != dive.divetrip))
+			continue;
+		res.put(snapshot_dive(pdive));
+	}
+	res.put(snapshot_dive(dive));
+	return res;
+}
+
+/* take into account previous dives until there is a 48h gap between dives */
+/* return last surface time before this dive or dummy value of 48h */
+/* return negative surface time if dives are overlapping */
+/* The place you call this function is likely the place where you want
+ * to create the deco_state */
+int dive_table::init_decompression(struct deco_state *ds, const struct dive *dive, bool in_planner) const
+{
+	int surface_time = 48 * 60 * 60;
+	timestamp_t last_endtime = 0, last_starttime = 0;
+	bool deco_init = false;
+	double surface_pressure;
+	uint64_t key = hash_seed;
+
+	if (!dive)
+		return false;
+
+	key = hash_value(key, (int)in_planner);
+	key = hash_value(key, (int)decoMode(in_planner));
+	key = hash_value(key, ds->settings.gf_low);
+	key = hash_value(key, ds->settings.gf_high);
+	key = hash_value(key, (int)ds->settings.vpmb_conservatism);
+
+	int nr_dives = static_cast<int>(size());
+	size_t divenr = get_idx(dive);
+	int i = deco_chain_start(dive, divenr) - 1;
 	/* Walk forward an add dives and surface intervals to deco */
 	while (++i < nr_dives) {
 #if DECO_CALC_DEBUG & 2
@@ -538,6 +674,28 @@ int dive_table::init_decompression(struct deco_state *ds, const struct dive *div
 #endif
 
 		surface_pressure = pdive.get_surface_pressure().mbar / 1000.0;
+		if (deco_init) {
+			surface_time = pdive.when - last_endtime;
+			if (surface_time < 0) {
+#if DECO_CALC_DEBUG & 2
+				printf("Exit because surface intervall is %d\n", surface_time);
+#endif
+				return surface_time;
+			}
+		}
+		last_starttime = pdive.when;
+		last_endtime = pdive.endtime();
+
+		key = hash_dive_for_deco(key, pdive);
+		if (get_end_of_dive_state(key, ds)) {
+			deco_init = true;
+#if DECO_CALC_DEBUG & 2
+			printf("Tissues of dive #%d from cache:\n", pdive.number);
+			dump_tissues(ds);
+#endif
+			continue;
+		}
+
 		/* Is it the first dive we add? */
 		if (!deco_init) {
 #if DECO_CALC_DEBUG & 2
@@ -550,13 +708,6 @@ int dive_table::init_decompression(struct deco_state *ds, const struct dive *div
 			dump_tissues(ds);
 #endif
 		} else {
-			surface_time = pdive.when - last_endtime;
-			if (surface_time < 0) {
-#if DECO_CALC_DEBUG & 2
-				printf("Exit because surface intervall is %d\n", surface_time);
-#endif
-				return surface_time;
-			}
 			add_segment(ds, surface_pressure, gasmix_air, surface_time, 0, OC, prefs.decosac, in_planner);
 #if DECO_CALC_DEBUG & 2
 			printf("Tissues after surface intervall of %d:%02u:\n", FRACTION_TUPLE(surface_time, 60));
@@ -566,9 +717,8 @@ int dive_table::init_decompression(struct deco_state *ds, const struct dive *div
 
 		add_dive_to_deco(ds, pdive, in_planner);
 
-		last_starttime = pdive.when;
-		last_endtime = pdive.endtime();
 		clear_vpmb_state(ds);
+		put_end_of_dive_state(key, ds);
 #if DECO_CALC_DEBUG & 2
 		printf("Tissues after added dive #%d:\n", pdive.number);
 		dump_tissues(ds);
@@ -34,6 +34,7 @@ struct dive_table : public sorted_owning_table<dive, &comp_dives> {
 	void fixup_dive(struct dive &dive) const;
 	void force_fixup_dive(struct dive &d) const;
 	int init_decompression(struct deco_state *ds, const struct dive *dive, bool in_planner) const;
+	dive_table deco_snapshot(const struct dive &dive) const;
 	void update_cylinder_related_info(struct dive &dive) const;
 	int get_dive_nr_at_idx(int idx) const;
 	timestamp_t get_surface_interval(timestamp_t when) const;
@@ -47,6 +48,7 @@ struct dive_table : public sorted_owning_table<dive, &comp_dives> {
 	std::unique_ptr<dive> clone_delete_divecomputer(const struct dive &d, int dc_number);
 private:
 	int calculate_cns(struct dive &dive) const; // Note: writes into dive->cns
+	int deco_chain_start(const struct dive *dive, size_t divenr) const;
 	std::array<std::unique_ptr<dive>, 2> split_dive_at(const struct dive &dive, int a, int b) const;
 	std::unique_ptr<dive> merge_two_dives(const struct dive &a_in, const struct dive &b_in, int offset, bool prefer_downloaded) const;
 };
@@ -39,10 +39,176 @@ dive_site *dive_site_table::get_by_name(const std::string &name) const
 	return get_by_predicate(*this, [&name](const auto &ds) { return ds->name == name; });
 }
 
+/* The location grids. The cells of the fine grid are 0.01 degrees wide, which is
+ * about 1.1 km in latitude, those of the coarse grid one degree. Sites with an
+ * invalid latitude are put into a separate bucket that is always searched. */
+static constexpr int grid_cell_udeg[] = { 10000, 1000000 };
+static constexpr uint64_t grid_invalid_key = ~uint64_t{0};
+
+static int grid_cell(int64_t udeg, int cell_udeg)
+{
+	return static_cast<int>(udeg >= 0 ? udeg / cell_udeg : (udeg - cell_udeg + 1) / cell_udeg);
+}
+
+/* Longitudes are wrapped into [-180, 180) */
+static int64_t wrap_longitude(int64_t udeg)
+{
+	return ((udeg + 180000000) % 360000000 + 360000000) % 360000000 - 180000000;
+}
+
+static uint64_t grid_key(int lat_cell, int lon_cell)
+{
+	return (static_cast<uint64_t>(static_cast<uint32_t>(lat_cell)) << 32) | static_cast<uint32_t>(lon_cell);
+}
+
+static uint64_t grid_key(location_t loc, int cell_udeg)
+{
+	if (loc.lat.udeg < -90000000 || loc.lat.udeg > 90000000)
+		return grid_invalid_key;
+	return grid_key(grid_cell(loc.lat.udeg, cell_udeg), grid_cell(wrap_longitude(loc.lon.udeg), cell_udeg));
+}
+
+void dive_site_table::add_to_grid(dive_site *ds)
+{
+	indexed_locations[ds] = ds->location;
+	if (!ds->has_gps_location())
+		return;
+	for (int i = 0; i < num_location_grids; ++i)
+		location_grids[i][grid_key(ds->location, grid_cell_udeg[i])].push_back(ds);
+}
+
+void dive_site_table::remove_from_grid(const dive_site *ds)
+{
+	auto it = indexed_locations.find(ds);
+	if (it == indexed_locations.end())
+		return;
+	if (has_location(&it->second)) {
+		for (int i = 0; i < num_location_grids; ++i) {
+			auto cell = location_grids[i].find(grid_key(it->second, grid_cell_udeg[i]));
+			if (cell == location_grids[i].end())
+				continue;
+			std::vector<dive_site *> &sites = cell->second;
+			sites.erase(std::remove(sites.begin(), sites.end(), ds), sites.end());
+			if (sites.empty())
+				location_grids[i].erase(cell);
+		}
+	}
+	indexed_locations.erase(it);
+}
+
+dive_site_table::put_result dive_site_table::put(std::unique_ptr<dive_site> ds)
+{
+	put_result res = sorted_owning_table::put(std::move(ds));
+	add_to_grid(res.ptr);
+	return res;
+}
+
+dive_site_table::pull_result dive_site_table::pull(const dive_site *ds)
+{
+	remove_from_grid(ds);
+	return sorted_owning_table::pull(ds);
+}
+
+void dive_site_table::clear()
+{
+	for (auto &grid: location_grids)
+		grid.clear();
+	indexed_locations.clear();
+	sorted_owning_table::clear();
+}
+
+/* Sites that are not in the table are ignored */
+void dive_site_table::location_changed(const dive_site *ds)
+{
+	auto it = indexed_locations.find(ds);
+	if (it == indexed_locations.end() || it->second == ds->location)
+		return;
+	remove_from_grid(ds);
+	add_to_grid(const_cast<dive_site *>(ds));
+}
+
+/* Call f for all sites indexed at exactly the given location */
+template <typename F>
+void dive_site_table::for_each_at(location_t loc, F f) const
+{
+	auto it = location_grids[0].find(grid_key(loc, grid_cell_udeg[0]));
+	if (it == location_grids[0].end())
+		return;
+	for (dive_site *ds: it->second)
+		f(ds);
+}
+
+/* Call f for all sites with GPS location that might be closer than distance meters.
+ * The caller has to check the actual distance. */
+template <typename F>
+void dive_site_table::for_each_in_radius(location_t loc, int distance, F f) const
+{
+	// Angular distance on a sphere with the radius used by get_distance(). Add one meter for rounding.
+	double delta = (distance + 1.0) / 6371000.0;
+	double lat = loc.lat.udeg / 1000000.0 * M_PI / 180.0;
+
+	auto all_sites = [this, &f]() {
+		for (const auto &ds: *this) {
+			if (ds->has_gps_location())
+				f(ds.get());
+		}
+	};
+
+	// Close to the poles or for large distances, the cells don't help: look at every site
+	if (std::abs(lat) + delta > 89.0 * M_PI / 180.0 || delta > 0.5 || !has_location(&loc) ||
+	    grid_key(loc, grid_cell_udeg[0]) == grid_invalid_key)
+		return all_sites();
+
+	// The largest difference in longitude on a circle around the location
+	double delta_lon = asin(std::min(1.0, sin(delta) / cos(lat)));
+	int64_t delta_lat_udeg = static_cast<int64_t>(delta * 180.0 / M_PI * 1000000.0) + 1;
+	int64_t delta_lon_udeg = static_cast<int64_t>(delta_lon * 180.0 / M_PI * 1000000.0) + 1;
+
+	// Use the finest grid with a reasonable number of cells to look at. Looking
+	// up many empty cells is slower than checking every site of a small table.
+	int64_t max_cells = std::clamp<int64_t>(size() / 4, 64, 1024);
+	for (int i = 0; i < num_location_grids; ++i) {
+		int lat_from = grid_cell(loc.lat.udeg - delta_lat_udeg, grid_cell_udeg[i]) - 1;
+		int lat_to = grid_cell(loc.lat.udeg + delta_lat_udeg, grid_cell_udeg[i]) + 1;
+		int lon_from = grid_cell(loc.lon.udeg - delta_lon_udeg, grid_cell_udeg[i]) - 1;
+		int lon_to = grid_cell(loc.lon.udeg + delta_lon_udeg, grid_cell_udeg[i]) + 1;
+		if (static_cast<int64_t>(lat_to - lat_from + 1) * (lon_to - lon_from + 1) > max_cells)
+			continue;
+
+		const auto &grid = location_grids[i];
+		for (int lat_cell = lat_from; lat_cell <= lat_to; ++lat_cell) {
+			for (int lon_cell = lon_from; lon_cell <= lon_to; ++lon_cell) {
+				int64_t lon_udeg = wrap_longitude(static_cast<int64_t>(lon_cell) * grid_cell_udeg[i]);
+				auto it = grid.find(grid_key(lat_cell, grid_cell(lon_udeg, grid_cell_udeg[i])));
+				if (it == grid.end())
+					continue;
+				for (dive_site *ds: it->second)
+					f(ds);
+			}
+		}
+		auto it = grid.find(grid_invalid_key);
+		if (it != grid.end()) {
+			for (dive_site *ds: it->second)
+				f(ds);
+		}
+		return;
+	}
+	all_sites();
+}
+
 /* there could be multiple sites at the same GPS fix - return the first one */
 dive_site *dive_site_table::get_by_gps(const location_t *loc) const
 {
-	return get_by_predicate(*this, [loc](const auto &ds) { return ds->location == *loc; });
+	if (!has_location(loc))
+		return get_by_predicate(*this, [loc](const auto &ds) { return ds->location == *loc; });
+
+	// The table is sorted by uuid, so the first one has the lowest uuid
+	dive_site *res = nullptr;
+	for_each_at(*loc, [loc, &res](dive_site *ds) {
+		if (ds->location == *loc && (!res || ds->uuid < res->uuid))
+			res = ds;
+	});
+	return res;
 }
 
 /* to avoid a bug where we have two dive sites with different name and the same GPS coordinates
@@ -50,22 +216,52 @@ dive_site *dive_site_table::get_by_gps(const location_t *loc) const
  * this function allows us to verify if a very specific name/GPS combination already exists */
 dive_site *dive_site_table::get_by_gps_and_name(const std::string &name, const location_t loc) const
 {
-	return get_by_predicate(*this, [&name, loc](const auto &ds) { return ds->location == loc &&
-									     ds->name == name; });
+	if (!has_location(&loc))
+		return get_by_predicate(*this, [&name, loc](const auto &ds) { return ds->location == loc &&
+										     ds->name == name; });
+
+	dive_site *res = nullptr;
+	for_each_at(loc, [&name, loc, &res](dive_site *ds) {
+		if (ds->location == loc && ds->name == name && (!res || ds->uuid < res->uuid))
+			res = ds;
+	});
+	return res;
 }
 
 /* find the closest one, no more than distance meters away - if more than one at same distance, pick the first */
 dive_site *dive_site_table::get_by_gps_proximity(location_t loc, int distance) const
 {
-	struct dive_site *res = nullptr;
-	unsigned int cur_distance, min_distance = distance;
-	for (const auto &ds: *this) {
-		if (ds->has_gps_location() &&
-		    (cur_distance = get_distance(ds->location, loc)) < min_distance) {
-			min_distance = cur_distance;
-			res = ds.get();
-		}
+	// Search in growing circles, so that for large distances we don't have to look at all sites.
+	// All sites closer than the radius are checked, so the first hit is the closest one.
+	for (int radius = std::min(distance, 1000); radius > 0; radius = std::min(distance, radius * 4)) {
+		struct dive_site *res = nullptr;
+		unsigned int cur_distance, min_distance = radius;
+		for_each_in_radius(loc, radius, [loc, &res, &cur_distance, &min_distance](dive_site *ds) {
+			if ((cur_distance = get_distance(ds->location, loc)) < min_distance ||
+			    (res && cur_distance == min_distance && ds->uuid < res->uuid)) {
+				min_distance = cur_distance;
+				res = ds;
+			}
+		});
+		if (res || radius == distance)
+			return res;
 	}
+	return nullptr;
+}
+
+std::vector<dive_site *> dive_site_table::get_by_gps_radius(location_t loc, int distance) const
+{
+	std::vector<std::pair<unsigned int, dive_site *>> sites;
+	for_each_in_radius(loc, distance, [loc, distance, &sites](dive_site *ds) {
+		unsigned int cur_distance = get_distance(ds->location, loc);
+		if (cur_distance < static_cast<unsigned int>(distance))
+			sites.emplace_back(cur_distance, ds);
+	});
+	std::sort(sites.begin(), sites.end(), [](const auto &a, const auto &b)
+		  { return a.first != b.first ? a.first < b.first : a.second->uuid < b.second->uuid; });
+	std::vector<dive_site *> res;
+	for (auto [dist, ds]: sites)
+		res.push_back(ds);
 	return res;
 }
 
@@ -192,7 +388,15 @@ static bool same(const struct dive_site &a, const struct dive_site &b)
 
 dive_site *dive_site_table::get_same(const struct dive_site &site) const
 {
-	return get_by_predicate(*this, [site](const auto &ds) { return same(*ds, site); });
+	if (!has_location(&site.location))
+		return get_by_predicate(*this, [&site](const auto &ds) { return same(*ds, site); });
+
+	dive_site *res = nullptr;
+	for_each_at(site.location, [&site, &res](dive_site *ds) {
+		if (same(*ds, site) && (!res || ds->uuid < res->uuid))
+			res = ds;
+	});
+	return res;
 }
 
 void dive_site::merge(dive_site &b)
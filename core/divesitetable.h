@@ -5,12 +5,18 @@
 #include "owning_table.h"
 #include "units.h"
 
+#include <unordered_map>
+
 struct dive_site;
 int divesite_comp_uuid(const dive_site &ds1, const dive_site &ds2);
 
 class dive_site_table : public sorted_owning_table<dive_site, &divesite_comp_uuid> {
 public:
 	put_result register_site(std::unique_ptr<dive_site> site); // Creates or changes UUID if duplicate
+	put_result put(std::unique_ptr<dive_site> site); // Also adds the site to the location index
+	pull_result pull(const dive_site *site); // Also removes the site from the location index
+	void clear();
+	void location_changed(const dive_site *site); // Must be called after changing the location of a site in the table
 	dive_site *get_by_uuid(uint32_t uuid) const;
 	dive_site *alloc_or_get(uint32_t uuid);
 	dive_site *create(const std::string &name);
@@ -20,8 +26,22 @@ public:
 	dive_site *get_by_gps(const location_t *) const;
 	dive_site *get_by_gps_and_name(const std::string &name, const location_t) const;
 	dive_site *get_by_gps_proximity(location_t, int distance) const;
+	std::vector<dive_site *> get_by_gps_radius(location_t, int distance) const; // Sites closer than distance, nearest first
 	dive_site *get_same(const struct dive_site &) const;
 	void purge_empty();
+private:
+	// Grids of the sites with a GPS location, so that the lookups by location
+	// only have to look at the sites nearby. A fine and a coarse grid are kept,
+	// so that larger distances don't have to look at too many cells. The key is
+	// made of the latitude and longitude cells. For each site, the location it is
+	// indexed under is kept.
+	static constexpr int num_location_grids = 2;
+	std::unordered_map<uint64_t, std::vector<dive_site *>> location_grids[num_location_grids];
+	std::unordered_map<const dive_site *, location_t> indexed_locations;
+	void add_to_grid(dive_site *ds);
+	void remove_from_grid(const dive_site *ds);
+	template <typename F> void for_each_in_radius(location_t loc, int distance, F f) const;
+	template <typename F> void for_each_at(location_t loc, F f) const;
 };
 
 #endif // DIVESITETABLE_H
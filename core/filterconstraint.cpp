@@ -3,6 +3,7 @@
 #include "dive.h"
 #include "divesite.h"
 #include "errorhelper.h"
+#include "fulltext.h"
 #include "gettextfromc.h"
 #include "qthelper.h"
 #include "tag.h"
@@ -815,22 +816,58 @@ static bool check(const filter_constraint &c, const QStringList &list)
 			   { return listContainsSuperstring(list, item, strchk); }) != c.negate;
 }
 
-static bool has_tags(const filter_constraint &c, const struct dive *d)
+static QStringList get_dive_tags(const struct dive *d)
 {
 	QStringList dive_tags;
 	for (const divetag *tag: d->tags)
 		dive_tags.push_back(QString::fromStdString(tag->name).trimmed());
-	return check(c, dive_tags);
+	return dive_tags;
 }
 
-static bool has_people(const filter_constraint &c, const struct dive *d)
+static QStringList get_dive_people(const struct dive *d)
 {
 	QStringList dive_people;
 	for (const QString &s: QString::fromStdString(d->buddy).split(",", SKIP_EMPTY))
 		dive_people.push_back(s.trimmed());
 	for (const QString &s: QString::fromStdString(d->diveguide).split(",", SKIP_EMPTY))
 		dive_people.push_back(s.trimmed());
-	return check(c, dive_people);
+	return dive_people;
+}
+
+static QStringList get_dive_suits(const struct dive *d)
+{
+	QStringList diveSuits;
+	if (!d->suit.empty())
+		diveSuits.push_back(QString::fromStdString(d->suit));
+	return diveSuits;
+}
+
+static QStringList get_dive_notes(const struct dive *d)
+{
+	QStringList diveNotes;
+	if (!d->notes.empty())
+		diveNotes.push_back(QString::fromStdString(d->notes));
+	return diveNotes;
+}
+
+filter_dive_strings filter_constraint_get_dive_strings(const struct dive *d)
+{
+	return { get_dive_tags(d), get_dive_people(d), get_dive_suits(d), get_dive_notes(d) };
+}
+
+// For dives registered in the fulltext index, use the cached strings
+static bool has_tags(const filter_constraint &c, const struct dive *d)
+{
+	if (d->full_text)
+		return check(c, d->full_text->filter_strings.tags);
+	return check(c, get_dive_tags(d));
+}
+
+static bool has_people(const filter_constraint &c, const struct dive *d)
+{
+	if (d->full_text)
+		return check(c, d->full_text->filter_strings.people);
+	return check(c, get_dive_people(d));
 }
 
 static bool has_locations(const filter_constraint &c, const struct dive *d)
@@ -865,18 +902,16 @@ static bool has_cylinder_type(const filter_constraint &c, const struct dive *d)
 
 static bool has_suits(const filter_constraint &c, const struct dive *d)
 {
-	QStringList diveSuits;
-	if (!d->suit.empty())
-		diveSuits.push_back(QString::fromStdString(d->suit));
-	return check(c, diveSuits);
+	if (d->full_text)
+		return check(c, d->full_text->filter_strings.suits);
+	return check(c, get_dive_suits(d));
 }
 
 static bool has_notes(const filter_constraint &c, const struct dive *d)
 {
-	QStringList diveNotes;
-	if (!d->notes.empty())
-		diveNotes.push_back(QString::fromStdString(d->notes));
-	return check(c, diveNotes);
+	if (d->full_text)
+		return check(c, d->full_text->filter_strings.notes);
+	return check(c, get_dive_notes(d));
 }
 
 static bool check_numerical_range(const filter_constraint &c, int v)
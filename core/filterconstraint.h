@@ -137,6 +137,13 @@ void filter_constraint_set_timestamp_from(filter_constraint &c, timestamp_t from
 void filter_constraint_set_timestamp_to(filter_constraint &c, timestamp_t to); // convert according to current units (metric or imperial)
 void filter_constraint_set_multiple_choice(filter_constraint &c, uint64_t);
 bool filter_constraint_match_dive(const filter_constraint &c, const struct dive *d);
+
+// The strings of a dive that string constraints are matched against. They are kept
+// in the fulltext cache of each registered dive, which is updated when the dive is edited.
+struct filter_dive_strings {
+	QStringList tags, people, suits, notes;
+};
+filter_dive_strings filter_constraint_get_dive_strings(const struct dive *d);
 std::string filter_constraint_data_to_string(const struct filter_constraint &constraint); // caller takes ownership of returned string
 
 #endif
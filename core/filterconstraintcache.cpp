@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "filterconstraintcache.h"
+#include "divelog.h"
+#include "divelist.h"
+#include "subsurface-qt/divelistnotifier.h"
+
+#include <algorithm>
+
+FilterConstraintCache::FilterConstraintCache()
+{
+	// Edited dives are updated by matchDive(). However, the constraints also
+	// look at the dive sites and trips, which are changed without touching
+	// the dives. Since these changes are rare, simply drop the whole cache.
+	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &FilterConstraintCache::clear);
+	connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, this, &FilterConstraintCache::clear);
+	connect(&diveListNotifier, &DiveListNotifier::tripChanged, this, &FilterConstraintCache::clear);
+
+	// Equipment edits and moves between trips don't go through the filter: update the rows of these dives.
+	connect(&diveListNotifier, &DiveListNotifier::cylindersReset, this, &FilterConstraintCache::refreshDives);
+	connect(&diveListNotifier, &DiveListNotifier::weightsystemsReset, this, &FilterConstraintCache::refreshDives);
+	connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, [this](dive *d, int) { refreshDive(d); });
+	connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, [this](dive *d, int) { refreshDive(d); });
+	connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, [this](dive *d, int) { refreshDive(d); });
+	connect(&diveListNotifier, &DiveListNotifier::weightAdded, [this](dive *d, int) { refreshDive(d); });
+	connect(&diveListNotifier, &DiveListNotifier::weightRemoved, [this](dive *d, int) { refreshDive(d); });
+	connect(&diveListNotifier, &DiveListNotifier::weightEdited, [this](dive *d, int) { refreshDive(d); });
+	connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips,
+		[this](dive_trip *, dive_trip *, bool, bool, const QVector<dive *> &dives) { refreshDives(dives); });
+}
+
+bool FilterConstraintCache::testBit(const std::vector<uint64_t> &bits, size_t idx)
+{
+	return (bits[idx / 64] >> (idx % 64)) & 1;
+}
+
+static void setBit(std::vector<uint64_t> &bits, size_t idx, bool value)
+{
+	if (value)
+		bits[idx / 64] |= uint64_t{1} << (idx % 64);
+	else
+		bits[idx / 64] &= ~(uint64_t{1} << (idx % 64));
+}
+
+void FilterConstraintCache::clear()
+{
+	entries.clear();
+	dives.clear();
+	diveIndexes.clear();
+}
+
+// Drop the cache if dives were added, removed or reordered.
+void FilterConstraintCache::updateDives()
+{
+	if (dives.size() == divelog.dives.size() &&
+	    std::equal(dives.begin(), dives.end(), divelog.dives.begin(),
+		       [](const dive *d1, const std::unique_ptr<dive> &d2) { return d1 == d2.get(); }))
+		return;
+	clear();
+	for (auto &d: divelog.dives) {
+		diveIndexes[d.get()] = dives.size();
+		dives.push_back(d.get());
+	}
+}
+
+// Reevaluate the cached constraints for a dive that was changed behind our back.
+void FilterConstraintCache::refreshDive(const dive *d)
+{
+	auto it = diveIndexes.find(d);
+	if (it == diveIndexes.end())
+		return;
+	for (Entry &entry: entries)
+		setBit(entry.matches, it->second, filter_constraint_match_dive(entry.constraint, d));
+}
+
+void FilterConstraintCache::refreshDives(const QVector<dive *> &dives)
+{
+	for (const dive *d: dives)
+		refreshDive(d);
+}
+
+std::vector<uint64_t> FilterConstraintCache::matches(const std::vector<filter_constraint> &constraints)
+{
+	updateDives();
+	size_t num_dives = dives.size();
+	size_t num_words = (num_dives + 63) / 64;
+
+	std::vector<Entry> newEntries;
+	for (const filter_constraint &c: constraints) {
+		auto it = std::find_if(entries.begin(), entries.end(),
+				       [&c](const Entry &entry) { return entry.constraint == c; });
+		if (it != entries.end()) {
+			newEntries.push_back(std::move(*it));
+			entries.erase(it);
+			continue;
+		}
+		Entry entry { c, std::vector<uint64_t>(num_words, 0) };
+		for (size_t i = 0; i < num_dives; ++i)
+			setBit(entry.matches, i, filter_constraint_match_dive(c, dives[i]));
+		newEntries.push_back(std::move(entry));
+	}
+	entries = std::move(newEntries);
+
+	std::vector<uint64_t> res(num_words, ~uint64_t{0});
+	for (const Entry &entry: entries) {
+		for (size_t i = 0; i < num_words; ++i)
+			res[i] &= entry.matches[i];
+	}
+	return res;
+}
+
+bool FilterConstraintCache::matchDive(const std::vector<filter_constraint> &constraints, const struct dive *d)
+{
+	auto it = diveIndexes.find(d);
+	bool useCache = it != diveIndexes.end() && entries.size() == constraints.size();
+	for (size_t i = 0; useCache && i < entries.size(); ++i)
+		useCache = entries[i].constraint == constraints[i];
+	if (!useCache) {
+		return std::all_of(constraints.begin(), constraints.end(),
+				   [d] (const filter_constraint &c) { return filter_constraint_match_dive(c, d); });
+	}
+
+	// The dive might have been edited: update its row
+	bool res = true;
+	for (Entry &entry: entries) {
+		bool match = filter_constraint_match_dive(entry.constraint, d);
+		setBit(entry.matches, it->second, match);
+		res &= match;
+	}
+	return res;
+}
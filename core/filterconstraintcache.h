@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-2.0
+// The results of the filter constraints for all dives, so that changing one
+// constraint doesn't reevaluate the others.
+#ifndef FILTERCONSTRAINTCACHE_H
+#define FILTERCONSTRAINTCACHE_H
+
+#include "filterconstraint.h"
+
+#include <QObject>
+#include <QVector>
+#include <unordered_map>
+#include <vector>
+
+struct dive;
+
+class FilterConstraintCache : public QObject {
+	Q_OBJECT
+public:
+	FilterConstraintCache();
+
+	// Returns a bitset of the dives that match all constraints. The bits are
+	// indexed by the position of the dive in the dive table. Only constraints
+	// that are not yet in the cache are evaluated.
+	std::vector<uint64_t> matches(const std::vector<filter_constraint> &constraints);
+
+	// Evaluates the constraints for a single dive, which may have been
+	// edited, and updates its row in the cache.
+	bool matchDive(const std::vector<filter_constraint> &constraints, const struct dive *d);
+
+	void clear();
+
+	static bool testBit(const std::vector<uint64_t> &bits, size_t idx);
+private:
+	struct Entry {
+		filter_constraint constraint;
+		std::vector<uint64_t> matches;
+	};
+
+	void updateDives();
+	void refreshDive(const dive *d);
+	void refreshDives(const QVector<dive *> &dives);
+
+	// The position of the dives in the dive table is remembered to detect
+	// added or removed dives.
+	std::vector<Entry> entries;
+	std::vector<const dive *> dives;
+	std::unordered_map<const dive *, size_t> diveIndexes;
+};
+
+#endif
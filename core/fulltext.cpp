@@ -9,10 +9,15 @@
 #include "qthelper.h"
 #include <QLocale>
 #include <map>
+#include <unordered_map>
 
 // The FullText-search class
 class FullText {
-	std::map<QString, std::vector<dive *>> words; // Dives that belong to each word
+	using word_map = std::map<QString, std::vector<uint32_t>>;
+	word_map words; // Dives that belong to each word, as full_text_cache::index
+	std::unordered_map<uint64_t, std::vector<const word_map::value_type *>> trigrams; // Words that contain each trigram
+	uint32_t numIndexes = 0; // Number of dive indexes handed out so far
+	std::vector<uint32_t> freeIndexes; // Indexes of unregistered dives, to be reused
 public:
 	void populate(); // Rebuild from current dive_table
 	void registerDive(struct dive *d); // Note: can be called repeatedly
@@ -20,9 +25,12 @@ public:
 	void unregisterAll(); // Unregister all dives in the dive table
 	FullTextResult find(const FullTextQuery &q, StringFilterMode mode) const; // Find dives matchin all words.
 private:
-	void registerWords(struct dive *d, const std::vector<QString> &w);
-	void unregisterWords(struct dive *d, const std::vector<QString> &w);
-	std::vector<dive *> findDives(const QString &s, StringFilterMode mode) const; // Find dives matching a given word.
+	void registerWords(uint32_t index, const std::vector<QString> &w);
+	void unregisterWords(uint32_t index, const std::vector<QString> &w);
+	void registerTrigrams(const word_map::value_type &word);
+	void unregisterTrigrams(const word_map::value_type &word);
+	std::vector<const word_map::value_type *> findSubstringWords(const QString &s) const;
+	std::vector<uint64_t> findDives(const QString &s, StringFilterMode mode) const; // Find dives matching a given word.
 };
 
 // This class doesn't depend on any other objects, we might just initialize it at startup.
@@ -150,19 +158,28 @@ void FullText::populate()
 
 void FullText::registerDive(struct dive *d)
 {
-	if (d->full_text)
-		unregisterWords(d, d->full_text->words);
-	else
+	if (d->full_text) {
+		unregisterWords(d->full_text->index, d->full_text->words);
+	} else {
 		d->full_text = std::make_unique<full_text_cache>();
+		if (freeIndexes.empty()) {
+			d->full_text->index = numIndexes++;
+		} else {
+			d->full_text->index = freeIndexes.back();
+			freeIndexes.pop_back();
+		}
+	}
 	d->full_text->words = getWords(d);
-	registerWords(d, d->full_text->words);
+	d->full_text->filter_strings = filter_constraint_get_dive_strings(d);
+	registerWords(d->full_text->index, d->full_text->words);
 }
 
 void FullText::unregisterDive(struct dive *d)
 {
 	if (!d->full_text)
 		return;
-	unregisterWords(d, d->full_text->words);
+	unregisterWords(d->full_text->index, d->full_text->words);
+	freeIndexes.push_back(d->full_text->index);
 	d->full_text.reset();
 }
 
@@ -171,20 +188,26 @@ void FullText::unregisterAll()
 	for (auto &d: divelog.dives)
 		d->full_text.reset();
 	words.clear();
+	trigrams.clear();
+	numIndexes = 0;
+	freeIndexes.clear();
 }
 
 // Register words of a dive.
-void FullText::registerWords(struct dive *d, const std::vector<QString> &w)
+void FullText::registerWords(uint32_t index, const std::vector<QString> &w)
 {
 	for (const QString &word: w) {
-		std::vector<dive *> &entry = words[word];
-		if (std::find(entry.begin(), entry.end(), d) == entry.end())
-			entry.push_back(d);
+		auto [it, inserted] = words.try_emplace(word);
+		if (inserted)
+			registerTrigrams(*it);
+		std::vector<uint32_t> &entry = it->second;
+		if (std::find(entry.begin(), entry.end(), index) == entry.end())
+			entry.push_back(index);
 	}
 }
 
 // Unregister words of a dive.
-void FullText::unregisterWords(struct dive *d, const std::vector<QString> &w)
+void FullText::unregisterWords(uint32_t index, const std::vector<QString> &w)
 {
 	for (const QString &word: w) {
 		auto it = words.find(word);
@@ -192,54 +215,127 @@ void FullText::unregisterWords(struct dive *d, const std::vector<QString> &w)
 			qWarning("FullText::unregisterWords: didn't find word '%s' in index!?", qPrintable(word));
 			continue;
 		}
-		std::vector<dive *> &entry = it->second;
-		entry.erase(std::remove(entry.begin(), entry.end(), d));
-		if (entry.empty())
+		std::vector<uint32_t> &entry = it->second;
+		entry.erase(std::remove(entry.begin(), entry.end(), index), entry.end());
+		if (entry.empty()) {
+			unregisterTrigrams(*it);
 			words.erase(it);
+		}
+	}
+}
+
+// The trigram index is used for substring searches: every word that contains a
+// string of three or more characters also contains all of its trigrams.
+// The trigrams are packed into a single integer. We work on UTF-16 code units,
+// which is what QString::contains() does, too.
+static uint64_t trigram(const QString &s, int pos)
+{
+	return ((uint64_t)s[pos].unicode() << 32) | ((uint64_t)s[pos + 1].unicode() << 16) | s[pos + 2].unicode();
+}
+
+// Get all trigrams of a string, without duplicates.
+static std::vector<uint64_t> getTrigrams(const QString &s)
+{
+	std::vector<uint64_t> res;
+	for (int pos = 0; pos + 3 <= s.size(); ++pos)
+		res.push_back(trigram(s, pos));
+	std::sort(res.begin(), res.end());
+	res.erase(std::unique(res.begin(), res.end()), res.end());
+	return res;
+}
+
+// Called when a word is added to the word index. The pointer to the map
+// entry stays valid until the word is removed from the index again.
+void FullText::registerTrigrams(const word_map::value_type &word)
+{
+	for (uint64_t t: getTrigrams(word.first))
+		trigrams[t].push_back(&word);
+}
+
+void FullText::unregisterTrigrams(const word_map::value_type &word)
+{
+	for (uint64_t t: getTrigrams(word.first)) {
+		auto it = trigrams.find(t);
+		if (it == trigrams.end())
+			continue;
+		std::vector<const word_map::value_type *> &entry = it->second;
+		entry.erase(std::remove(entry.begin(), entry.end(), &word), entry.end());
+		if (entry.empty())
+			trigrams.erase(it);
 	}
 }
 
-// Add dives from second array to first, if not yet there
-void combineDives(std::vector<dive *> &to, const std::vector<dive *> &from)
+// Find all words that contain a string of at least three characters.
+// Only the words sharing the rarest trigram of the string have to be checked.
+std::vector<const FullText::word_map::value_type *> FullText::findSubstringWords(const QString &s) const
 {
-	for (dive *d: from) {
-		if (std::find(to.begin(), to.end(), d) == to.end())
-			to.push_back(d);
+	const std::vector<const word_map::value_type *> *candidates = nullptr;
+	for (uint64_t t: getTrigrams(s)) {
+		auto it = trigrams.find(t);
+		if (it == trigrams.end())
+			return {};
+		if (!candidates || it->second.size() < candidates->size())
+			candidates = &it->second;
+	}
+	if (!candidates)
+		return {};
+
+	std::vector<const word_map::value_type *> res;
+	for (const word_map::value_type *word: *candidates) {
+		if (word->first.contains(s))
+			res.push_back(word);
 	}
+	return res;
+}
+
+// The posting lists of the words are short compared to the number of dives,
+// so they are stored as plain lists of indexes. The results of the searches
+// are bitsets with one bit per index. Thus, combining the results of
+// multiple words works on 64 dives at a time.
+
+// Add dives from a posting list to a result bitset.
+static void combineDives(std::vector<uint64_t> &to, const std::vector<uint32_t> &from)
+{
+	for (uint32_t index: from)
+		to[index / 64] |= uint64_t{1} << (index % 64);
 }
 
-std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode) const
+static bool noDives(const std::vector<uint64_t> &dives)
 {
+	return std::all_of(dives.begin(), dives.end(), [](uint64_t bits) { return bits == 0; });
+}
+
+std::vector<uint64_t> FullText::findDives(const QString &s, StringFilterMode mode) const
+{
+	std::vector<uint64_t> res((numIndexes + 63) / 64, 0);
 	switch (mode) {
 	case StringFilterMode::EXACT:
 	default: {
 		// Try to access a single word
 		auto it = words.find(s);
-		if (it == words.end())
-			return {};
-		return it->second;
+		if (it != words.end())
+			combineDives(res, it->second);
+		return res;
 	}
 	case StringFilterMode::STARTSWITH: {
 		// Find all words that start with a substring. We use the fact
 		// that these words must form a contiguous block, since the words are
 		// ordered lexicographically.
-		auto it = words.lower_bound(s);
-		if (it == words.end() || !it->first.startsWith(s))
-			return {};
-		std::vector<dive *> res = it->second;
-		++it;
-		while (it != words.end() && it->first.startsWith(s)) {
+		for (auto it = words.lower_bound(s); it != words.end() && it->first.startsWith(s); ++it)
 			combineDives(res, it->second);
-			++it;
-		}
 		return res;
 	}
 	case StringFilterMode::SUBSTRING: {
-		// Find all words that contain a substring. Here, we have to check all words!
-		std::vector<dive *> res;
-		for (auto it = words.begin(); it != words.end(); ++it) {
-			if (it->first.contains(s))
-				combineDives(res, it->second);
+		// Find all words that contain a substring. Short strings are not
+		// covered by the trigram index. Here, we have to check all words!
+		if (s.size() < 3) {
+			for (auto it = words.begin(); it != words.end(); ++it) {
+				if (it->first.contains(s))
+					combineDives(res, it->second);
+			}
+		} else {
+			for (const word_map::value_type *word: findSubstringWords(s))
+				combineDives(res, word->second);
 		}
 		return res;
 	}
@@ -251,12 +347,12 @@ FullTextResult FullText::find(const FullTextQuery &q, StringFilterMode mode) con
 	if (q.words.empty())
 		return FullTextResult();
 
-	std::vector<dive *> res = findDives(q.words[0], mode);
-	for (size_t i = 1; i < q.words.size(); ++i) {
-		std::vector<dive *> res2 = findDives(q.words[i], mode);
+	std::vector<uint64_t> res = findDives(q.words[0], mode);
+	for (size_t i = 1; i < q.words.size() && !noDives(res); ++i) {
+		std::vector<uint64_t> res2 = findDives(q.words[i], mode);
 		// Remove dives from res that are not in res2
-		res.erase(std::remove_if(res.begin(), res.end(),
-				[&res2] (dive *d) { return std::find(res2.begin(), res2.end(), d) == res2.end(); }), res.end());
+		for (size_t j = 0; j < res.size(); ++j)
+			res[j] &= res2[j];
 	}
 
 	return { std::move(res) };
@@ -277,5 +373,7 @@ bool FullTextQuery::doit() const
 
 bool FullTextResult::dive_matches(const struct dive *d) const
 {
-	return std::find(dives.begin(), dives.end(), d) != dives.end();
+	if (!d->full_text || d->full_text->index / 64 >= bits.size())
+		return false;
+	return (bits[d->full_text->index / 64] >> (d->full_text->index % 64)) & 1;
 }
@@ -9,8 +9,10 @@
 #ifndef FULLTEXT_H
 #define FULLTEXT_H
 
+#include "filterconstraint.h"
 #include <QString>
 #include <vector>
+#include <cstdint>
 
 struct dive;
 void fulltext_register(struct dive *d); // Note: can be called repeatedly
@@ -27,6 +29,8 @@ enum class StringFilterMode {
 // This class caches each dives words, so that we can unregister a dive from the full text search
 struct full_text_cache {
 	std::vector<QString> words;
+	uint32_t index; // Position of the dive in the result bitsets, reused after unregistering
+	filter_dive_strings filter_strings;
 };
 
 // A fulltext query. Basically a list of normalized words we search for
@@ -37,9 +41,10 @@ struct FullTextQuery {
 	bool doit() const; // true if we should to a fulltext search
 };
 
-// Describes the result of a fulltext search
+// Describes the result of a fulltext search.
+// One bit for each registered dive, indexed by full_text_cache::index.
 struct FullTextResult {
-	std::vector<dive *> dives;
+	std::vector<uint64_t> bits;
 	bool dive_matches(const struct dive *d) const;
 };
 
@@ -4,12 +4,15 @@
 
 #include "git2.h"
 #include "filterpreset.h"
+#include "sample.h"
 #include <string>
 
 struct dive_log;
 struct git_oid;
 struct git_repository;
 struct divelog;
+struct dive;
+struct divecomputer;
 
 #define CLOUD_HOST_US "ssrf-cloud-us.subsurface-divelog.org"  // preferred (faster/bigger) server in the US
 #define CLOUD_HOST_U2 "ssrf-cloud-u2.subsurface-divelog.org"  // secondary (older) server in the US
@@ -49,7 +52,55 @@ extern bool remote_repo_uptodate(const char *filename, struct git_info *info);
 extern int sync_with_remote(struct git_info *);
 extern int git_save_dives(struct git_info *, bool select_only);
 extern int git_load_dives(struct git_info *, struct divelog *log);
+extern void set_git_parallel_load(bool enable);
+extern void set_git_parallel_save(bool enable);
+extern uint64_t dc_git_hash(const struct dive &dive, const struct divecomputer &dc, bool binary_samples);
 extern int do_git_save(struct git_info *, bool select_only, bool create_empty);
 extern int git_create_local_repo(const std::string &filename);
 
+/*
+ * Optionally, the samples of a dive computer are stored in binary after
+ * the text lines of the dive computer blob. They are introduced by a line
+ * "binarysamples <version> <count>" and extend to the end of the blob.
+ * The samples are stored column by column. Each column starts with the
+ * value of the first sample and a flag whether all samples have that value.
+ * If not, the differences to the previous sample follow. All numbers are
+ * zigzag-encoded varints. Repositories that use this format say so in the
+ * version line of the settings: "version 4 binarysamples 1". The bumped
+ * data format version makes older versions, which would parse the binary
+ * data as sample lines, warn about a newer file.
+ * The format is written if prefs.git_binary_samples is set.
+ */
+static constexpr int git_binary_samples_version = 1;
+static constexpr int git_binary_samples_dataformat_version = 4;
+
+/*
+ * Call the function with an accessor for each column of the binary sample
+ * format, in the order they are stored. Changing the columns requires a
+ * new git_binary_samples_version.
+ */
+template <typename F>
+void for_each_binary_sample_column(F f)
+{
+	f([](auto &s) -> auto & { return s.time.seconds; });
+	f([](auto &s) -> auto & { return s.depth.mm; });
+	f([](auto &s) -> auto & { return s.temperature.mkelvin; });
+	for (int i = 0; i < MAX_SENSORS; i++) {
+		f([i](auto &s) -> auto & { return s.pressure[i].mbar; });
+		f([i](auto &s) -> auto & { return s.sensor[i]; });
+	}
+	f([](auto &s) -> auto & { return s.ndl.seconds; });
+	f([](auto &s) -> auto & { return s.tts.seconds; });
+	f([](auto &s) -> auto & { return s.rbt.seconds; });
+	f([](auto &s) -> auto & { return s.in_deco; });
+	f([](auto &s) -> auto & { return s.stoptime.seconds; });
+	f([](auto &s) -> auto & { return s.stopdepth.mm; });
+	f([](auto &s) -> auto & { return s.cns; });
+	f([](auto &s) -> auto & { return s.setpoint.mbar; });
+	for (int i = 0; i < MAX_O2_SENSORS; i++)
+		f([i](auto &s) -> auto & { return s.o2sensor[i].mbar; });
+	f([](auto &s) -> auto & { return s.heartbeat; });
+	f([](auto &s) -> auto & { return s.bearing.degrees; });
+}
+
 #endif // GITACCESS_H
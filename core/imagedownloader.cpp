@@ -5,20 +5,24 @@
 #include "errorhelper.h"
 #include "qthelper.h"
 #include "imagedownloader.h"
+#include "thumbnailstore.h"
 #include "videoframeextractor.h"
 #include "qt-models/divepicturemodel.h"
 #include "metadata.h"
+#include "settings/qPrefMedia.h"
 #include <unistd.h>
 #include <QString>
 #include <QImageReader>
 #include <QSvgRenderer>
 #include <QDataStream>
 #include <QPainter>
+#include <QThread>
 #ifdef LIBRAW_SUPPORT
 #include <libraw/libraw.h>
 #endif
 
 #include <QtConcurrent>
+#include <algorithm>
 
 // Note: this is a global instead of a function-local variable on purpose.
 // We don't want this to be generated in a different thread context if
@@ -132,7 +136,13 @@ Thumbnailer::Thumbnail Thumbnailer::fetchImage(const QString &urlfilename, const
 			return fetchVideoThumbnail(filename, originalFilename, md.duration);
 
 		// Try if Qt can parse this image. If it does, use this as a thumbnail.
-		QImage thumb(filename);
+		// Let the reader scale the image, so that JPEGs are not decoded at full resolution.
+		QImageReader reader(filename);
+		QSize imageSize = reader.size();
+		int size = maxThumbnailSize();
+		if (imageSize.isValid() && (imageSize.width() > size || imageSize.height() > size))
+			reader.setScaledSize(imageSize.scaled(size, size, Qt::KeepAspectRatio));
+		QImage thumb = reader.read();
 
 #ifdef LIBRAW_SUPPORT
 		// If note, perhaps a raw image?
@@ -140,7 +150,6 @@ Thumbnailer::Thumbnail Thumbnailer::fetchImage(const QString &urlfilename, const
 			thumb = fetchRawThumbnail(filename);
 #endif
 		if (!thumb.isNull()) {
-			int size = maxThumbnailSize();
 			thumb = thumb.scaled(size, size, Qt::KeepAspectRatio);
 			return addPictureThumbnailToCache(originalFilename, thumb);
 		}
@@ -204,9 +213,8 @@ Thumbnailer::Thumbnailer() : failImage(QPixmap(":filter-close").scaled(maxThumbn
 	videoOverlayImage.fill(Qt::transparent);
 	QPainter painter(&videoOverlayImage);
 	videoOverlayRenderer.render(&painter);
-	// Currently, we only process one image at a time. Stefan Fuchs reported problems when
-	// calculating multiple thumbnails at once and this hopefully helps.
-	pool.setMaxThreadCount(1);
+	setMaxThreadCount(prefs.thumbnail_threads);
+	connect(qPrefMedia::instance(), &qPrefMedia::thumbnail_threadsChanged, this, &Thumbnailer::setMaxThreadCount);
 	connect(ImageDownloader::instance(), &ImageDownloader::loaded, this, &Thumbnailer::imageDownloaded);
 	connect(ImageDownloader::instance(), &ImageDownloader::failed, this, &Thumbnailer::imageDownloadFailed);
 	connect(VideoFrameExtractor::instance(), &VideoFrameExtractor::extracted, this, &Thumbnailer::frameExtracted);
@@ -271,34 +279,55 @@ Thumbnailer::Thumbnail Thumbnailer::getVideoThumbnailFromStream(QDataStream &str
 	return { res, MEDIATYPE_VIDEO, { .seconds = (int32_t)duration } };
 }
 
+// Thumbnails used to be stored in one file per picture. Move such a
+// thumbnail into the thumbnail store. Returns a null byte array if there is none.
+static QByteArray importThumbnailFile(const QString &picture_filename, const QByteArray &key, qint64 &mtime)
+{
+	QFile file(thumbnailFileName(picture_filename));
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+	QByteArray res = file.readAll();
+	QDateTime thumbnailTime = QFileInfo(file).lastModified();
+	file.close();
+	if (res.isEmpty() || !ThumbnailStore::instance()->put(key, res))
+		return QByteArray();
+	file.remove();
+	// Keep the time of the old file, so that outdated thumbnails are still recognized.
+	mtime = thumbnailTime.isValid() ? thumbnailTime.toMSecsSinceEpoch() : 0;
+	return res;
+}
+
 // Fetch a thumbnail from cache.
 // If Thumbnail::QImage is null, the thumbnail is scheduled for recreation.
 Thumbnailer::Thumbnail Thumbnailer::getThumbnailFromCache(const QString &picture_filename)
 {
-	QString filename = thumbnailFileName(picture_filename);
-	if (filename.isEmpty())
+	QByteArray key = thumbnailHash(picture_filename);
+	if (key.isEmpty())
+		return { QImage(), MEDIATYPE_UNKNOWN, duration_t() };
+
+	// The data points directly into the memory mapped thumbnail store.
+	qint64 mtime = 0;
+	QByteArray data = ThumbnailStore::instance()->get(key, &mtime);
+	if (data.isNull())
+		data = importThumbnailFile(picture_filename, key, mtime);
+	if (data.isNull())
 		return { QImage(), MEDIATYPE_UNKNOWN, duration_t() };
-	QFile file(filename);
 
 	if (prefs.auto_recalculate_thumbnails) {
 		// Check if thumbnails is older than the (local) image file
 		QString filenameLocal = localFilePath(qPrintable(picture_filename));
 		QFileInfo pictureInfo(filenameLocal);
-		QFileInfo thumbnailInfo(file);
-		if (pictureInfo.exists() && thumbnailInfo.exists()) {
+		if (pictureInfo.exists()) {
 			QDateTime pictureTime = pictureInfo.lastModified();
-			QDateTime thumbnailTime = thumbnailInfo.lastModified();
-			if (pictureTime.isValid() && thumbnailTime.isValid() && thumbnailTime < pictureTime) {
-				// Both files exist, have valid timestamps and thumbnail was calculated before picture.
+			if (pictureTime.isValid() && mtime > 0 && mtime < pictureTime.toMSecsSinceEpoch()) {
+				// Thumbnail has a valid timestamp and was calculated before picture.
 				// Return an empty thumbnail to signal recalculation of the thumbnail
 				return { QImage(), MEDIATYPE_UNKNOWN, duration_t() };
 			}
 		}
 	}
 
-	if (!file.open(QIODevice::ReadOnly))
-		return { QImage(), MEDIATYPE_UNKNOWN, duration_t() };
-	QDataStream stream(&file);
+	QDataStream stream(data);
 
 	// Each thumbnail file is composed of a media-type and an image file.
 	quint32 type;
@@ -323,26 +352,23 @@ Thumbnailer::Thumbnail Thumbnailer::addVideoThumbnailToCache(const QString &pict
 	//	for each picture:
 	//		uint32	offset in msec from begining of video
 	//		QImage	frame
-	QString filename = thumbnailFileName(picture_filename);
-	QSaveFile file(filename);
-	if (file.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&file);
-
-		stream << (quint32)MEDIATYPE_VIDEO;
-		stream << (quint32)duration.seconds;
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
 
-		if (image.isNull()) {
-			// No image provided
-			stream << (quint32)0;
-		} else {
-			// Currently, we support at most one image
-			stream << (quint32)1;
-			stream << (quint32)position.seconds;
-			stream << image;
-		}
+	stream << (quint32)MEDIATYPE_VIDEO;
+	stream << (quint32)duration.seconds;
 
-		file.commit();
+	if (image.isNull()) {
+		// No image provided
+		stream << (quint32)0;
+	} else {
+		// Currently, we support at most one image
+		stream << (quint32)1;
+		stream << (quint32)position.seconds;
+		stream << image;
 	}
+
+	ThumbnailStore::instance()->put(thumbnailHash(picture_filename), data);
 	return { videoImage, MEDIATYPE_VIDEO, duration };
 }
 
@@ -364,27 +390,22 @@ Thumbnailer::Thumbnail Thumbnailer::addPictureThumbnailToCache(const QString &pi
 {
 	// The format of a picture-thumbnail is very simple:
 	// 	uint32	MEDIATYPE_PICTURE
-	// 	QImage	thumbnail
-	QString filename = thumbnailFileName(picture_filename);
-	QSaveFile file(filename);
-	if (file.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&file);
-
-		stream << (quint32)MEDIATYPE_PICTURE;
-		stream << thumbnail;
-		file.commit();
-	}
+	// 	QImage	thumbnail (PNG compressed by QDataStream)
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+
+	stream << (quint32)MEDIATYPE_PICTURE;
+	stream << thumbnail;
+	ThumbnailStore::instance()->put(thumbnailHash(picture_filename), data);
 	return { thumbnail, MEDIATYPE_PICTURE, duration_t() };
 }
 
 Thumbnailer::Thumbnail Thumbnailer::addUnknownThumbnailToCache(const QString &picture_filename)
 {
-	QString filename = thumbnailFileName(picture_filename);
-	QSaveFile file(filename);
-	if (file.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&file);
-		stream << (quint32)MEDIATYPE_UNKNOWN;
-	}
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream << (quint32)MEDIATYPE_UNKNOWN;
+	ThumbnailStore::instance()->put(thumbnailHash(picture_filename), data);
 	return { unknownImage, MEDIATYPE_UNKNOWN, duration_t() };
 }
 
@@ -467,7 +488,7 @@ void Thumbnailer::imageDownloaded(QString filename)
 {
 	// Image was downloaded -> try thumbnailing again.
 	QMutexLocker l(&lock);
-	workingOn[filename] = QtConcurrent::run(&pool, [this, filename]() { processItem(filename, false); });
+	schedule(filename, WorkType::FetchDownloaded, false, false);
 }
 
 void Thumbnailer::imageDownloadFailed(QString filename)
@@ -497,9 +518,14 @@ QImage Thumbnailer::fetchThumbnail(const QString &filename, bool synchronous)
 	QMutexLocker l(&lock);
 
 	// We are not currently fetching this thumbnail - add it to the list.
+	// If it is only queued because it is visible, don't cancel it anymore.
 	if (!workingOn.contains(filename)) {
-		workingOn.insert(filename,
-				 QtConcurrent::run(&pool, [this, filename]() { processItem(filename, true); }));
+		schedule(filename, WorkType::Fetch, false, false);
+	} else {
+		for (WorkItem &item: queue) {
+			if (item.filename == filename)
+				item.cancellable = false;
+		}
 	}
 	return dummyImage;
 }
@@ -508,11 +534,68 @@ void Thumbnailer::calculateThumbnails(const QVector<QString> &filenames)
 {
 	QMutexLocker l(&lock);
 	for (const QString &filename: filenames) {
-		if (!workingOn.contains(filename)) {
-			workingOn.insert(filename,
-					 QtConcurrent::run(&pool, [this, filename]() { recalculate(filename); }));
+		if (!workingOn.contains(filename))
+			schedule(filename, WorkType::Recalculate, false, false);
+	}
+}
+
+void Thumbnailer::setVisibleThumbnails(const QVector<QString> &filenames)
+{
+	QSet<QString> visible;
+	for (const QString &filename: filenames)
+		visible.insert(filename);
+
+	QMutexLocker l(&lock);
+	for (auto it = queue.begin(); it != queue.end(); ) {
+		it->visible = visible.contains(it->filename);
+		if (!it->visible && it->cancellable) {
+			workingOn.remove(it->filename);
+			it = queue.erase(it);
+		} else {
+			++it;
 		}
 	}
+	for (const QString &filename: filenames) {
+		if (!workingOn.contains(filename))
+			schedule(filename, WorkType::Fetch, true, true);
+	}
+}
+
+// Must be called with the lock held. Every item gets its own task, but when
+// a task starts it takes the most urgent item, not necessarily its own.
+// Tasks whose items were cancelled find an empty queue and return.
+void Thumbnailer::schedule(const QString &filename, WorkType type, bool visible, bool cancellable)
+{
+	workingOn.insert(filename);
+	queue.push_back({ filename, type, visible, cancellable });
+	QtConcurrent::run(&pool, [this]() { processNext(); });
+}
+
+void Thumbnailer::processNext()
+{
+	WorkItem item;
+	{
+		QMutexLocker l(&lock);
+		if (queue.empty())
+			return;
+		auto it = std::find_if(queue.begin(), queue.end(), [](const WorkItem &i) { return i.visible; });
+		if (it == queue.end())
+			it = queue.begin();
+		item = std::move(*it);
+		queue.erase(it);
+	}
+
+	switch (item.type) {
+	case WorkType::Fetch:
+		processItem(item.filename, true);
+		break;
+	case WorkType::FetchDownloaded:
+		processItem(item.filename, false);
+		break;
+	case WorkType::Recalculate:
+		recalculate(item.filename);
+		break;
+	}
 }
 
 void Thumbnailer::clearWorkQueue()
@@ -521,12 +604,27 @@ void Thumbnailer::clearWorkQueue()
 	// we don't get thumbnails that we don't care about.
 	VideoFrameExtractor::instance()->clearWorkQueue();
 
+	// Thumbnails that are already being calculated are not interrupted.
 	QMutexLocker l(&lock);
-	for (auto it = workingOn.begin(); it != workingOn.end(); ++it)
-		it->cancel();
+	queue.clear();
 	workingOn.clear();
 }
 
+void Thumbnailer::setMaxThreadCount(int count)
+{
+	// Since the images are decoded at thumbnail size, a worker needs little memory.
+	// Nevertheless, limit the default number of workers, since reading is mostly
+	// limited by the disk.
+	if (count <= 0)
+		count = std::clamp(QThread::idealThreadCount(), 1, 4);
+	pool.setMaxThreadCount(count);
+}
+
+QImage Thumbnailer::placeholderThumbnail() const
+{
+	return dummyImage;
+}
+
 static const int maxZoom = 3;	// Maximum zoom: thrice of standard size
 
 int Thumbnailer::defaultThumbnailSize()
@@ -7,6 +7,8 @@
 #include <QFuture>
 #include <QNetworkReply>
 #include <QThreadPool>
+#include <QSet>
+#include <deque>
 
 class ImageDownloader : public QObject {
 	Q_OBJECT
@@ -42,8 +44,21 @@ public:
 	// Schedule multiple thumbnails for forced recalculation
 	void calculateThumbnails(const QVector<QString> &filenames);
 
+	// Set the thumbnails that are currently shown to the user. These are
+	// calculated before all other thumbnails and are scheduled if necessary.
+	// Pending thumbnails that were only scheduled because they were shown
+	// are cancelled once they are not shown anymore.
+	void setVisibleThumbnails(const QVector<QString> &filenames);
+
 	// If we change dive, clear all unfinished thumbnail creations
 	void clearWorkQueue();
+
+	// The number of thumbnails that are calculated concurrently. A count of zero or
+	// less chooses a default from the number of cores. Follows prefs.thumbnail_threads.
+	void setMaxThreadCount(int count);
+
+	// Shown while the thumbnail is fetched
+	QImage placeholderThumbnail() const;
 	static int maxThumbnailSize();
 	static int defaultThumbnailSize();
 	static int thumbnailSize(double zoomLevel);
@@ -62,7 +77,21 @@ private:
 		duration_t duration;
 	};
 
+	enum class WorkType {
+		Fetch,
+		FetchDownloaded,	// Don't try to download again
+		Recalculate
+	};
+	struct WorkItem {
+		QString filename;
+		WorkType type;
+		bool visible;		// Calculated before items that are not visible
+		bool cancellable;	// Only scheduled because it was visible
+	};
+
 	Thumbnailer();
+	void schedule(const QString &filename, WorkType type, bool visible, bool cancellable);
+	void processNext();
 	Thumbnail fetchVideoThumbnail(const QString &filename, const QString &originalFilename, duration_t duration);
 	Thumbnail extractVideoThumbnail(const QString &picture_filename, duration_t duration);
 	Thumbnail addPictureThumbnailToCache(const QString &picture_filename, const QImage &thumbnail);
@@ -85,7 +114,8 @@ private:
 	QImage videoOverlayImage;	// Overlay for video thumbnails
 	QImage unknownImage;		// Place holder for files where we couldn't determine the type
 
-	QMap<QString,QFuture<void>> workingOn;
+	std::deque<WorkItem> queue;	// Items that were not yet started
+	QSet<QString> workingOn;	// Items that are queued or running
 };
 
 #endif // IMAGEDOWNLOADER_H
@@ -10,7 +10,12 @@
 #include <fcntl.h>
 #include <git2.h>
 #include <array>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <libdivecomputer/parser.h>
 
 #include "gettext.h"
@@ -35,9 +40,25 @@
 // TODO: Should probably be moved to struct divelog to allow for multi-document
 std::string saved_git_id;
 
+struct git_blob_prefetch;
+
+/* A dive computer file whose parsing was deferred, see parse_divecomputer_entry() */
+struct pending_dc {
+	struct dive *dive;
+	size_t dc_idx;
+	int o2pressure_sensor;
+	std::string content;
+	bool binary_samples = false;
+};
+
 struct git_parser_state {
 	git_repository *repo = nullptr;
+	struct git_blob_prefetch *prefetch = nullptr;
+	bool defer_samples = false;
+	std::vector<pending_dc> pending_dcs;
+	std::vector<std::unique_ptr<dive>> pending_dives;
 	struct divecomputer *active_dc = nullptr;
+	const struct dive *active_dc_dive = nullptr; // dive of active_dc
 	std::unique_ptr<dive> active_dive;
 	std::unique_ptr<dive_trip> active_trip;
 	std::string fulltext_mode;
@@ -61,7 +82,7 @@ struct keyword_action {
 	void (*fn)(char *, struct git_parser_state *);
 };
 
-static git_blob *git_tree_entry_blob(git_repository *repo, const git_tree_entry *entry);
+static bool read_tree_entry(struct git_parser_state *state, const git_tree_entry *entry, std::string &content);
 
 static temperature_t get_temperature(const char *line)
 {
@@ -194,6 +215,7 @@ static void parse_dive_gps(char *line, struct git_parser_state *state)
 			ds->notes += format_string_std(translate("gettextFromC", "multiple GPS locations for this dive site; also %s\n"), coords.c_str());
 		}
 		ds->location = location;
+		state->log->sites.location_changed(ds);
 	}
 
 }
@@ -670,8 +692,8 @@ static struct sample *new_sample(struct git_parser_state *state)
 		sample->pressure[0] = 0_bar;
 		sample->pressure[1] = 0_bar;
 	} else {
-		sample->sensor[0] = sanitize_sensor_id(state->active_dive.get(), !state->o2pressure_sensor);
-		sample->sensor[1] = sanitize_sensor_id(state->active_dive.get(), state->o2pressure_sensor);
+		sample->sensor[0] = sanitize_sensor_id(state->active_dc_dive, !state->o2pressure_sensor);
+		sample->sensor[1] = sanitize_sensor_id(state->active_dc_dive, state->o2pressure_sensor);
 	}
 	return sample;
 }
@@ -914,8 +936,17 @@ static void parse_settings_version(char *line, struct git_parser_state *)
 {
 	int version = atoi(line);
 	report_datafile_version(version);
-	if (version > dataformat_version)
-		report_error("Git save file version %d is newer than version %d I know about", version, dataformat_version);
+	if (version > git_binary_samples_dataformat_version)
+		report_error("Git save file version %d is newer than version %d I know about", version, git_binary_samples_dataformat_version);
+
+	/* The binary sample format is announced on the same line, see git-access.h */
+	const char *binary = strstr(line, "binarysamples ");
+	if (binary) {
+		int binary_version = atoi(binary + strlen("binarysamples "));
+		if (binary_version > git_binary_samples_version)
+			report_error("Git save file binary sample format %d is newer than format %d I know about",
+				     binary_version, git_binary_samples_version);
+	}
 }
 
 /* The argument string is the version string of subsurface that saved things, just FYI */
@@ -1347,10 +1378,10 @@ static unsigned parse_one_line(const char *buf, unsigned size, line_fn_t *fn, st
  * strings, but the callback function can consume the
  * strings.
  */
-static void for_each_line(git_blob *blob, line_fn_t *fn, struct git_parser_state *state)
+static void for_each_line(const std::string &blob, line_fn_t *fn, struct git_parser_state *state)
 {
-	const char *content = (const char *)git_blob_rawcontent(blob);
-	unsigned int size = git_blob_rawsize(blob);
+	const char *content = blob.data();
+	unsigned int size = blob.size();
 
 	while (size) {
 		state->converted_strings.clear();
@@ -1361,6 +1392,91 @@ static void for_each_line(git_blob *blob, line_fn_t *fn, struct git_parser_state
 	}
 }
 
+static bool get_varint(const unsigned char *&p, const unsigned char *end, int64_t &v)
+{
+	uint64_t u = 0;
+	for (int shift = 0; p < end && shift < 64; shift += 7) {
+		unsigned char c = *p++;
+		u |= (uint64_t)(c & 0x7f) << shift;
+		if (!(c & 0x80)) {
+			v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+/* A week of one-second samples. Larger counts come from corrupt data. */
+static const size_t max_binary_samples = 7 * 24 * 3600;
+
+/* See git-access.h for a description of the format */
+static bool parse_binary_samples(const unsigned char *p, const unsigned char *end, size_t count, struct divecomputer *dc)
+{
+	std::vector<sample> &samples = dc->samples;
+	size_t start = samples.size();
+	bool ok = true;
+
+	if (count > max_binary_samples)
+		return false;
+	samples.resize(start + count);
+	for_each_binary_sample_column([&](auto get) {
+		int64_t v, constant;
+		if (!ok || !get_varint(p, end, v) || !get_varint(p, end, constant)) {
+			ok = false;
+			return;
+		}
+		for (size_t i = start; i < samples.size(); i++) {
+			int64_t delta = 0;
+			if (i > start && !constant && !get_varint(p, end, delta)) {
+				ok = false;
+				return;
+			}
+			v += delta;
+			auto &field = get(samples[i]);
+			field = static_cast<std::remove_reference_t<decltype(field)>>(v);
+		}
+	});
+	if (!ok)
+		samples.resize(start);
+	return ok;
+}
+
+/*
+ * Dive computer files are text, except for the samples, which may be stored
+ * in binary at the end. Returns true if that was the case.
+ */
+static bool parse_dc_blob(const std::string &blob, struct git_parser_state *state)
+{
+	static const char marker[] = "binarysamples ";
+	const char *content = blob.data();
+	unsigned int size = blob.size();
+
+	while (size) {
+		if (size > sizeof(marker) - 1 && !memcmp(content, marker, sizeof(marker) - 1)) {
+			const char *nl = (const char *)memchr(content, '\n', size);
+			if (!nl)
+				break;
+			char *end;
+			long version = strtol(content + sizeof(marker) - 1, &end, 10);
+			unsigned long long count = strtoull(end, &end, 10);
+			if (version > git_binary_samples_version) {
+				report_error("Binary sample format %ld is newer than format %d I know about", version, git_binary_samples_version);
+				return true;
+			}
+			const unsigned char *data = (const unsigned char *)nl + 1;
+			if (!parse_binary_samples(data, (const unsigned char *)content + size, count, state->active_dc))
+				report_error("Corrupt binary sample data");
+			return true;
+		}
+		state->converted_strings.clear();
+		state->act_converted_string = 0;
+		unsigned int n = parse_one_line(content, size, divecomputer_parser, state);
+		content += n;
+		size -= n;
+	}
+	return false;
+}
+
 #define GIT_WALK_OK   0
 #define GIT_WALK_SKIP 1
 
@@ -1372,10 +1488,22 @@ static void finish_active_trip(struct git_parser_state *state)
 		state->log->trips.put(std::move(trip));
 }
 
+/* The deferred dive computers are parsed in batches, so that their blobs don't pile up */
+static const size_t max_pending_dcs = 256;
+static void parse_pending_dcs(struct git_parser_state *state);
+
 static void finish_active_dive(struct git_parser_state *state)
 {
-	if (state->active_dive)
+	if (!state->active_dive)
+		return;
+	/* When the samples are parsed later, the dive can only be fixed up after that */
+	if (state->defer_samples) {
+		state->pending_dives.push_back(std::move(state->active_dive));
+		if (state->pending_dcs.size() >= max_pending_dcs)
+			parse_pending_dcs(state);
+	} else {
 		state->log->dives.record_dive(std::move(state->active_dive));
+	}
 }
 
 static void create_new_dive(timestamp_t when, struct git_parser_state *state)
@@ -1614,14 +1742,165 @@ static int walk_tree_directory(const char *root, const git_tree_entry *entry, st
 	return dive_trip_directory(root, name, state);
 }
 
-static git_blob *git_tree_entry_blob(git_repository *repo, const git_tree_entry *entry)
+/*
+ * Looking up and inflating the blobs dominates the load time of large
+ * repositories. Therefore, before parsing, the ids of all files in the
+ * tree are collected and the blobs are read in parallel, while the tree
+ * is parsed. The parsing itself still walks the tree in order, since it
+ * depends on the order of the entries (active trip, dive, dive computer,
+ * etc.). To bound the memory use, the readers stay at most
+ * prefetch_window blobs ahead of the parser.
+ */
+static bool git_parallel_load = true;
+static const size_t prefetch_window = 1024;
+
+void set_git_parallel_load(bool enable)
 {
+	git_parallel_load = enable;
+}
+
+struct git_blob_prefetch {
+	enum class status : char { pending, loading, loaded, taken };
+	std::vector<git_oid> ids;
+	std::vector<std::string> contents;
+	std::vector<status> statuses;
+	std::unordered_map<std::string, size_t> index;	// raw id -> index into the arrays above
+	std::vector<std::thread> threads;
+
+	// Protected by lock
+	std::mutex lock;
+	std::condition_variable cond;
+	size_t next = 0;	// The next blob to be read
+	size_t taken = 0;	// Number of blobs handed out to the parser
+	bool stop = false;
+};
+
+static std::string raw_oid(const git_oid *id)
+{
+	return std::string((const char *)id->id, GIT_OID_RAWSZ);
+}
+
+/* Collect the files in the directories that walk_tree_directory() might recurse into */
+static int prefetch_walk_cb(const char *, const git_tree_entry *entry, void *payload)
+{
+	struct git_blob_prefetch *prefetch = (git_blob_prefetch *)payload;
+	const char *name = git_tree_entry_name(entry);
+
+	if (git_tree_entry_filemode(entry) == GIT_FILEMODE_TREE)
+		return isdigit(*name) || !strcmp(name, "Pictures") ? GIT_WALK_OK : GIT_WALK_SKIP;
+
 	const git_oid *id = git_tree_entry_id(entry);
-	git_blob *blob;
+	if (prefetch->index.emplace(raw_oid(id), prefetch->ids.size()).second)
+		prefetch->ids.push_back(*id);
+	return GIT_WALK_OK;
+}
+
+/* libgit2 repositories must not be shared between threads, therefore every worker opens its own */
+static void prefetch_worker(const char *path, struct git_blob_prefetch *prefetch)
+{
+	using status = git_blob_prefetch::status;
+	git_repository *repo;
+	if (git_repository_open(&repo, path))
+		return;
+	std::unique_lock<std::mutex> l(prefetch->lock);
+	for (;;) {
+		prefetch->cond.wait(l, [prefetch] { return prefetch->stop || prefetch->next < prefetch->taken + prefetch_window; });
+		if (prefetch->stop || prefetch->next >= prefetch->ids.size())
+			break;
+		size_t i = prefetch->next++;
+		if (prefetch->statuses[i] != status::pending)
+			continue;
+		prefetch->statuses[i] = status::loading;
+		l.unlock();
+
+		std::string content;
+		git_blob *blob;
+		bool ok = !git_blob_lookup(&blob, repo, &prefetch->ids[i]);
+		if (ok) {
+			content.assign((const char *)git_blob_rawcontent(blob), git_blob_rawsize(blob));
+			git_blob_free(blob);
+		}
+
+		l.lock();
+		// On failure, the parser tries again and reports the error
+		if (ok)
+			prefetch->contents[i] = std::move(content);
+		prefetch->statuses[i] = ok ? status::loaded : status::pending;
+		prefetch->cond.notify_all();
+	}
+	l.unlock();
+	git_repository_free(repo);
+}
+
+static void start_prefetch(git_repository *repo, git_tree *tree, struct git_blob_prefetch *prefetch)
+{
+	git_tree_walk(tree, GIT_TREEWALK_PRE, prefetch_walk_cb, prefetch);
+	prefetch->contents.resize(prefetch->ids.size());
+	prefetch->statuses.resize(prefetch->ids.size(), git_blob_prefetch::status::pending);
+
+	size_t nr_threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), prefetch->ids.size());
+	for (size_t i = 0; i < nr_threads; i++)
+		prefetch->threads.emplace_back(prefetch_worker, git_repository_path(repo), prefetch);
+}
+
+static void stop_prefetch(struct git_blob_prefetch *prefetch)
+{
+	{
+		std::lock_guard<std::mutex> l(prefetch->lock);
+		prefetch->stop = true;
+	}
+	prefetch->cond.notify_all();
+	for (std::thread &thread: prefetch->threads)
+		thread.join();
+	prefetch->threads.clear();
+}
+
+/*
+ * Take a blob from the prefetched blobs. Waits if the blob is just being read.
+ * Each prefetched blob is handed out only once to release the memory as early
+ * as possible. Returns false if the caller has to read the blob itself.
+ */
+static bool take_prefetched_blob(struct git_blob_prefetch *prefetch, const git_oid *id, std::string &content)
+{
+	using status = git_blob_prefetch::status;
+	auto it = prefetch->index.find(raw_oid(id));
+	if (it == prefetch->index.end())
+		return false;
+	size_t i = it->second;
+
+	std::unique_lock<std::mutex> l(prefetch->lock);
+	prefetch->cond.wait(l, [prefetch, i] { return prefetch->statuses[i] != status::loading; });
+	status s = prefetch->statuses[i];
+	if (s == status::taken)
+		return false;
+
+	// Also a blob that wasn't read yet counts as taken, so that the readers move on
+	prefetch->statuses[i] = status::taken;
+	prefetch->taken++;
+	prefetch->cond.notify_all();
+	if (s != status::loaded)
+		return false;
+	content = std::move(prefetch->contents[i]);
+	return true;
+}
+
+/*
+ * Get the content of a file, either from the prefetched blobs or from the
+ * repository.
+ */
+static bool read_tree_entry(struct git_parser_state *state, const git_tree_entry *entry, std::string &content)
+{
+	const git_oid *id = git_tree_entry_id(entry);
+
+	if (state->prefetch && take_prefetched_blob(state->prefetch, id, content))
+		return true;
 
-	if (git_blob_lookup(&blob, repo, id))
-		return NULL;
-	return blob;
+	git_blob *blob;
+	if (git_blob_lookup(&blob, state->repo, id))
+		return false;
+	content.assign((const char *)git_blob_rawcontent(blob), git_blob_rawsize(blob));
+	git_blob_free(blob);
+	return true;
 }
 
 static struct divecomputer *create_new_dc(struct dive *dive)
@@ -1639,25 +1918,76 @@ static struct divecomputer *create_new_dc(struct dive *dive)
 }
 
 /*
- * We should *really* try to delay the dive computer data parsing
- * until necessary, in order to reduce load-time. The parsing is
- * cheap, but the loading of the git blob into memory can be pretty
- * costly.
+ * Parsing the samples of the dive computers is the bulk of the work.
+ * It only depends on the dive computer and the cylinders of the dive,
+ * so it can be deferred until a batch of dives was read and then be
+ * done in parallel, see parse_pending_dcs() and finish_active_dive().
+ * The samples are still parsed while loading and not on first access,
+ * because fixup_dive() derives the depths, temperatures, SAC, CNS and
+ * OTU of every dive from them.
  */
 static int parse_divecomputer_entry(struct git_parser_state *state, const git_tree_entry *entry, const char *)
 {
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
+	std::string blob;
 
-	if (!blob)
+	if (!read_tree_entry(state, entry, blob))
 		return report_error("Unable to read divecomputer file");
 
-	state->active_dc = create_new_dc(state->active_dive.get());
-	for_each_line(blob, divecomputer_parser, state);
-	git_blob_free(blob);
+	struct dive *dive = state->active_dive.get();
+	state->active_dc = create_new_dc(dive);
+	memcpy(state->active_dc->git_id.data(), git_tree_entry_id(entry)->id, 20);
+	if (state->defer_samples) {
+		size_t dc_idx = state->active_dc - dive->dcs.data();
+		state->pending_dcs.push_back({ dive, dc_idx, state->o2pressure_sensor, std::move(blob) });
+	} else {
+		state->active_dc_dive = dive;
+		bool binary_samples = parse_dc_blob(blob, state);
+		state->active_dc_dive = nullptr;
+		/* Remember which data the blob was created from, so that saving can reuse it */
+		state->active_dc->git_hash = dc_git_hash(*dive, *state->active_dc, binary_samples);
+	}
 	state->active_dc = NULL;
 	return 0;
 }
 
+static void parse_pending_dcs_worker(struct git_parser_state *state, std::atomic<size_t> *next)
+{
+	/* Every thread needs its own parser state for the converted strings */
+	struct git_parser_state local_state;
+	size_t i;
+	while ((i = (*next)++) < state->pending_dcs.size()) {
+		struct pending_dc &pending = state->pending_dcs[i];
+		local_state.active_dc = &pending.dive->dcs[pending.dc_idx];
+		local_state.active_dc_dive = pending.dive;
+		local_state.o2pressure_sensor = pending.o2pressure_sensor;
+		pending.binary_samples = parse_dc_blob(pending.content, &local_state);
+		pending.content = std::string();
+	}
+}
+
+/* Parse the deferred dive computers in parallel and then add the dives in the original order */
+static void parse_pending_dcs(struct git_parser_state *state)
+{
+	size_t nr_threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), state->pending_dcs.size());
+	std::atomic<size_t> next = 0;
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < nr_threads; i++)
+		threads.emplace_back(parse_pending_dcs_worker, state, &next);
+	for (std::thread &thread: threads)
+		thread.join();
+
+	/* Remember which data the blobs were created from, so that saving can reuse them */
+	for (auto &pending: state->pending_dcs) {
+		struct divecomputer &dc = pending.dive->dcs[pending.dc_idx];
+		dc.git_hash = dc_git_hash(*pending.dive, dc, pending.binary_samples);
+	}
+	state->pending_dcs.clear();
+
+	for (auto &dive: state->pending_dives)
+		state->log->dives.record_dive(std::move(dive));
+	state->pending_dives.clear();
+}
+
 /*
  * NOTE! The "git_id" for the dive is the hash for the whole dive directory.
  * As such, it covers not just the dive, but the divecomputers and the
@@ -1666,15 +1996,14 @@ static int parse_divecomputer_entry(struct git_parser_state *state, const git_tr
  */
 static int parse_dive_entry(struct git_parser_state *state, const git_tree_entry *entry, const char *suffix)
 {
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
+	std::string blob;
+	if (!read_tree_entry(state, entry, blob))
 		return report_error("Unable to read dive file");
 	if (*suffix)
 		state->active_dive->number = atoi(suffix + 1);
 	state->active_dive->weightsystems.clear();
 	state->o2pressure_sensor = 1;
 	for_each_line(blob, dive_parser, state);
-	git_blob_free(blob);
 	return 0;
 }
 
@@ -1684,38 +2013,36 @@ static int parse_site_entry(struct git_parser_state *state, const git_tree_entry
 		return report_error("Dive site without uuid");
 	uint32_t uuid = strtoul(suffix, NULL, 16);
 	state->active_site = state->log->sites.alloc_or_get(uuid);
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
+	std::string blob;
+	if (!read_tree_entry(state, entry, blob))
 		return report_error("Unable to read dive site file");
 	for_each_line(blob, site_parser, state);
+	state->log->sites.location_changed(state->active_site);
 	state->active_site = NULL;
-	git_blob_free(blob);
 	return 0;
 }
 
 static int parse_trip_entry(struct git_parser_state *state, const git_tree_entry *entry)
 {
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
+	std::string blob;
+	if (!read_tree_entry(state, entry, blob))
 		return report_error("Unable to read trip file");
 	for_each_line(blob, trip_parser, state);
-	git_blob_free(blob);
 	return 0;
 }
 
 static int parse_settings_entry(struct git_parser_state *state, const git_tree_entry *entry)
 {
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
+	std::string blob;
+	if (!read_tree_entry(state, entry, blob))
 		return report_error("Unable to read settings file");
 	for_each_line(blob, settings_parser, state);
-	git_blob_free(blob);
 	return 0;
 }
 
 static int parse_picture_entry(struct git_parser_state *state, const git_tree_entry *entry, const char *name)
 {
-	git_blob *blob;
+	std::string blob;
 	int hh, mm, ss, offset;
 	char sign;
 
@@ -1732,15 +2059,13 @@ static int parse_picture_entry(struct git_parser_state *state, const git_tree_en
 	if (sign == '-')
 		offset = -offset;
 
-	blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
+	if (!read_tree_entry(state, entry, blob))
 		return report_error("Unable to read picture file");
 
 	state->active_pic.offset.seconds = offset;
 
 	for_each_line(blob, picture_parser, state);
 	add_picture(state->active_dive->pictures, std::move(state->active_pic));
-	git_blob_free(blob);
 
 	/* add_picture took ownership of the data -
 	 * clear out our copy just to be sure. */
@@ -1750,15 +2075,13 @@ static int parse_picture_entry(struct git_parser_state *state, const git_tree_en
 
 static int parse_filter_preset(struct git_parser_state *state, const git_tree_entry *entry)
 {
-	git_blob *blob = git_tree_entry_blob(state->repo, entry);
-	if (!blob)
+	std::string blob;
+	if (!read_tree_entry(state, entry, blob))
 		return report_error("Unable to read filter preset file");
 
 	state->active_filter = std::make_unique<filter_preset>();
 	for_each_line(blob, filter_preset_parser, state);
 
-	git_blob_free(blob);
-
 	state->log->filter_presets.add(*state->active_filter);
 	state->active_filter.reset();
 
@@ -1817,7 +2140,17 @@ static int walk_tree_cb(const char *root, const git_tree_entry *entry, void *pay
 
 static int load_dives_from_tree(git_repository *repo, git_tree *tree, struct git_parser_state *state)
 {
+	struct git_blob_prefetch prefetch;
+	if (git_parallel_load) {
+		start_prefetch(repo, tree, &prefetch);
+		state->prefetch = &prefetch;
+		state->defer_samples = true;
+	}
 	git_tree_walk(tree, GIT_TREEWALK_PRE, walk_tree_cb, state);
+	if (state->prefetch) {
+		stop_prefetch(&prefetch);
+		state->prefetch = nullptr;
+	}
 	return 0;
 }
 
@@ -1897,5 +2230,6 @@ int git_load_dives(struct git_info *info, struct divelog *log)
 	ret = do_git_load(info->repo, info->branch.c_str(), &state);
 	finish_active_dive(&state);
 	finish_active_trip(&state);
+	parse_pending_dcs(&state);
 	return ret;
 }
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <charconv>
 
 #include "units.h"
 #include "membuffer.h"
@@ -131,30 +132,74 @@ void put_format(struct membuffer *b, const char *fmt, ...)
 	va_end(args);
 }
 
+/* Digits of an unsigned number, padded to the given width */
+static void put_digits(struct membuffer *b, unsigned long long value, int width, char pad)
+{
+	char buf[24];
+	int len = std::to_chars(buf, buf + sizeof(buf), value).ptr - buf;
+
+	make_room(b, len > width ? len : width);
+	for (; width > len; width--)
+		b->buffer[b->len++] = pad;
+	memcpy(b->buffer + b->len, buf, len);
+	b->len += len;
+}
+
+void put_int(struct membuffer *b, const char *pre, long long value, const char *post)
+{
+	put_string(b, pre);
+	if (value < 0) {
+		put_bytes(b, "-", 1);
+		put_digits(b, 0ull - (unsigned long long)value, 0, ' ');
+	} else {
+		put_digits(b, value, 0, ' ');
+	}
+	put_string(b, post);
+}
+
+void put_uint(struct membuffer *b, const char *pre, unsigned long long value, const char *post, int width)
+{
+	put_string(b, pre);
+	put_digits(b, value, width, ' ');
+	put_string(b, post);
+}
+
+void put_minsec(struct membuffer *b, const char *pre, int seconds, const char *post, int width)
+{
+	put_string(b, pre);
+	put_digits(b, (unsigned)seconds / 60, width, ' ');
+	put_bytes(b, ":", 1);
+	put_digits(b, (unsigned)seconds % 60, 2, '0');
+	put_string(b, post);
+}
+
 void put_milli(struct membuffer *b, const char *pre, int value, const char *post)
 {
 	int i;
-	char buf[4];
-	const char *sign = "";
+	char buf[3];
+	int len = 3;
 	unsigned v;
 
+	put_string(b, pre);
 	v = value;
 	if (value < 0) {
-		sign = "-";
+		put_bytes(b, "-", 1);
 		v = -value;
 	}
 	for (i = 2; i >= 0; i--) {
 		buf[i] = (v % 10) + '0';
 		v /= 10;
 	}
-	buf[3] = 0;
 	if (buf[2] == '0') {
-		buf[2] = 0;
+		len = 2;
 		if (buf[1] == '0')
-			buf[1] = 0;
+			len = 1;
 	}
 
-	put_format(b, "%s%s%u.%s%s", pre, sign, v, buf, post);
+	put_digits(b, v, 0, ' ');
+	put_bytes(b, ".", 1);
+	put_bytes(b, buf, len);
+	put_string(b, post);
 }
 
 void put_temperature(struct membuffer *b, temperature_t temp, const char *pre, const char *post)
@@ -172,7 +217,7 @@ void put_depth(struct membuffer *b, depth_t depth, const char *pre, const char *
 void put_duration(struct membuffer *b, duration_t duration, const char *pre, const char *post)
 {
 	if (duration.seconds)
-		put_format(b, "%s%u:%02u%s", pre, FRACTION_TUPLE(duration.seconds, 60), post);
+		put_minsec(b, pre, duration.seconds, post);
 }
 
 void put_pressure(struct membuffer *b, pressure_t pressure, const char *pre, const char *post)
@@ -184,7 +229,7 @@ void put_pressure(struct membuffer *b, pressure_t pressure, const char *pre, con
 void put_salinity(struct membuffer *b, int salinity, const char *pre, const char *post)
 {
 	if (salinity)
-		put_format(b, "%s%d%s", pre, salinity / 10, post);
+		put_int(b, pre, salinity / 10, post);
 }
 
 void put_degrees(struct membuffer *b, degrees_t value, const char *pre, const char *post)
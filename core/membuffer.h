@@ -57,6 +57,18 @@ extern __printf(2, 3) void put_format(struct membuffer *, const char *fmt, ...);
 /* Output one of our "milli" values with type and pre/post data */
 extern void put_milli(struct membuffer *, const char *, int, const char *);
 
+/*
+ * Locale-independent formatters for integers and durations with pre/post
+ * data. They don't have to parse a format string, which matters for the
+ * samples, of which there are millions. put_int() corresponds to "%d",
+ * put_uint() to "%u" and put_minsec() to "%u:%02u" with the minutes and
+ * seconds of the duration. With a non-zero width, the number respectively
+ * the minutes are padded with spaces to that width.
+ */
+extern void put_int(struct membuffer *, const char *, long long, const char *);
+extern void put_uint(struct membuffer *, const char *, unsigned long long, const char *, int width = 0);
+extern void put_minsec(struct membuffer *, const char *, int seconds, const char *, int width = 0);
+
 /*
  * Helper functions for showing particular types. If the type
  * is empty, nothing is done, and the function returns false.
@@ -10,9 +10,11 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <assert.h>
+#include <algorithm>
 #include <libxml/parser.h>
 #include <libxml/parserInternals.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include <libxslt/transform.h>
 #include <libdivecomputer/parser.h>
 
@@ -1154,6 +1156,7 @@ static void gps_lat(const char *buffer, struct dive *dive, struct parser_state *
 			report_info("Oops, changing the latitude of existing dive site id %8x name %s; not good", ds->uuid,
 					ds->name.empty() ? "(unknown)" : ds->name.c_str());
 		ds->location.lat = location.lat;
+		state->log->sites.location_changed(ds);
 	}
 }
 
@@ -1171,6 +1174,7 @@ static void gps_long(const char *buffer, struct dive *dive, struct parser_state
 			report_info("Oops, changing the longitude of existing dive site id %8x name %s; not good", ds->uuid,
 					ds->name.empty() ? "(unknown)" : ds->name.c_str());
 		ds->location.lon = location.lon;
+		state->log->sites.location_changed(ds);
 	}
 }
 
@@ -1218,6 +1222,7 @@ static void gps_in_dive(const char *buffer, struct dive *dive, struct parser_sta
 			ds->notes += format_string_std(translate("gettextFromC", "multiple GPS locations for this dive site; also %s\n"), coords.c_str());
 		} else {
 			ds->location = location;
+			state->log->sites.location_changed(ds);
 		}
 	}
 }
@@ -1532,23 +1537,20 @@ static bool entry(const char *name, char *buf, struct parser_state *state)
 	return true;
 }
 
-static const char *nodename(xmlNode *node, char *buf, int len)
+/*
+ * Build the "name.parent" string used for matching from the names of
+ * a node and its ancestors, given innermost first and NULL-terminated.
+ */
+static const char *nodename_from_names(const char *const names[], char *buf, int len)
 {
 	int levels = 2;
 	char *p = buf;
 
-	if (!node || (node->type != XML_CDATA_SECTION_NODE && !node->name)) {
-		return "root";
-	}
-
-	if (node->type == XML_CDATA_SECTION_NODE || (node->parent && !strcmp((const char *)node->name, "text")))
-		node = node->parent;
-
 	/* Make sure it's always NUL-terminated */
 	p[--len] = 0;
 
-	for (;;) {
-		const char *name = (const char *)node->name;
+	for (int i = 0;; i++) {
+		const char *name = names[i];
 		char c;
 		while ((c = *name++) != 0) {
 			/* Cheaper 'tolower()' for ASCII */
@@ -1558,10 +1560,10 @@ static const char *nodename(xmlNode *node, char *buf, int len)
 				return buf;
 		}
 		*p = 0;
-		node = node->parent;
-		if (!node || !node->name)
+		if (!names[i + 1])
 			return buf;
 		*p++ = '.';
+		*p = 0;
 		if (!--len)
 			return buf;
 		if (!--levels)
@@ -1569,6 +1571,23 @@ static const char *nodename(xmlNode *node, char *buf, int len)
 	}
 }
 
+static const char *nodename(xmlNode *node, char *buf, int len)
+{
+	const char *names[4] = { NULL };
+
+	if (!node || (node->type != XML_CDATA_SECTION_NODE && !node->name)) {
+		return "root";
+	}
+
+	if (node->type == XML_CDATA_SECTION_NODE || (node->parent && !strcmp((const char *)node->name, "text")))
+		node = node->parent;
+
+	for (int i = 0; i < 3 && node && node->name; i++, node = node->parent)
+		names[i] = (const char *)node->name;
+
+	return nodename_from_names(names, buf, len);
+}
+
 #define MAXNAME 32
 
 static bool visit_one_node(xmlNode *node, struct parser_state *state)
@@ -1669,13 +1688,26 @@ static struct nesting {
 	  { NULL, }
 };
 
+/* Returns the terminating entry with no callbacks if there is no rule for the element */
+static const struct nesting *find_nesting(const char *name)
+{
+	const struct nesting *rule = nesting;
+
+	do {
+		if (!strcmp(rule->name, name))
+			break;
+		rule++;
+	} while (rule->name);
+	return rule;
+}
+
 static bool traverse(xmlNode *root, struct parser_state *state)
 {
 	xmlNode *n;
 	bool ret = true;
 
 	for (n = root; n; n = n->next) {
-		struct nesting *rule = nesting;
+		const struct nesting *rule;
 
 		if (!n->name) {
 			if ((ret = visit(n, state)) == false)
@@ -1683,11 +1715,7 @@ static bool traverse(xmlNode *root, struct parser_state *state)
 			continue;
 		}
 
-		do {
-			if (!strcmp(rule->name, (const char *)n->name))
-				break;
-			rule++;
-		} while (rule->name);
+		rule = find_nesting((const char *)n->name);
 
 		if (rule->start)
 			rule->start(state);
@@ -1738,14 +1766,155 @@ static const char *preprocess_divelog_de(const char *buffer)
 	return buffer;
 }
 
+/*
+ * Native Subsurface files don't need any XSLT transformation, so instead of
+ * building the whole document tree they are parsed with a streaming reader.
+ * The rules and entry() calls are the same as for traverse(): the start rule
+ * of an element, its attributes, its non-blank text, its children and
+ * finally its end rule.
+ */
+static bool xml_streaming = true;
+
+void set_xml_streaming(bool streaming)
+{
+	xml_streaming = streaming;
+}
+
+/* The ancestors of the node are the first "depth" entries of "elements" */
+static bool visit_stream_value(xmlTextReaderPtr reader, const char *node_name, const std::vector<std::string> &elements,
+			       size_t depth, std::string &value, struct parser_state *state)
+{
+	const char *names[4] = { node_name, NULL };
+	char buffer[MAXNAME];
+	const xmlChar *content = xmlTextReaderConstValue(reader);
+
+	if (!content || std::all_of(content, content + xmlStrlen(content), [](xmlChar c) { return IS_BLANK_CH(c); }))
+		return true;
+
+	for (size_t i = 1; i < 3 && i <= depth; i++)
+		names[i] = elements[depth - i].c_str();
+	value.assign((const char *)content);
+	return entry(nodename_from_names(names, buffer, sizeof(buffer)), value.data(), state);
+}
+
+/*
+ * Starts at the node the reader is positioned on.
+ * Returns -1 on a reader error, 0 if entry() gave up and 1 on success.
+ */
+static int traverse_stream(xmlTextReaderPtr reader, struct parser_state *state)
+{
+	std::vector<std::string> elements;
+	std::vector<const struct nesting *> rules;
+	std::string value;
+	int res;
+
+	do {
+		switch (xmlTextReaderNodeType(reader)) {
+		case XML_READER_TYPE_ELEMENT: {
+			const char *name = (const char *)xmlTextReaderConstName(reader);
+			const struct nesting *rule = find_nesting(name);
+			bool empty = xmlTextReaderIsEmptyElement(reader);
+
+			if (rule->start)
+				rule->start(state);
+			elements.push_back(name);
+			while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+				if (!visit_stream_value(reader, (const char *)xmlTextReaderConstName(reader),
+							elements, elements.size(), value, state))
+					return 0;
+			}
+			xmlTextReaderMoveToElement(reader);
+			if (empty) {
+				elements.pop_back();
+				if (rule->end)
+					rule->end(state);
+			} else {
+				rules.push_back(rule);
+			}
+			break;
+		}
+		case XML_READER_TYPE_END_ELEMENT:
+			if (rules.empty())
+				return -1;
+			elements.pop_back();
+			if (rules.back()->end)
+				rules.back()->end(state);
+			rules.pop_back();
+			break;
+		case XML_READER_TYPE_TEXT:
+		case XML_READER_TYPE_CDATA:
+			if (elements.empty())
+				break;
+			if (!visit_stream_value(reader, elements.back().c_str(), elements, elements.size() - 1, value, state))
+				return 0;
+			break;
+		case XML_READER_TYPE_COMMENT:
+			if (!visit_stream_value(reader, "comment", elements, elements.size(), value, state))
+				return 0;
+			break;
+		default:
+			break;
+		}
+	} while ((res = xmlTextReaderRead(reader)) == 1);
+	return res == 0 ? 1 : -1;
+}
+
+/*
+ * Parse a native file with the streaming reader. If the file turns out not
+ * to be one, or the reader fails, nothing has been added to the log and
+ * the caller falls back to the document parser.
+ */
+static bool parse_xml_stream(const char *url, const char *buffer, struct divelog *log, int *ret)
+{
+	struct parser_state state;
+	xmlTextReaderPtr reader;
+	int res;
+
+	reader = xmlReaderForMemory(buffer, strlen(buffer), url, NULL, XML_PARSE_HUGE);
+	if (!reader)
+		return false;
+
+	/* Only look at files whose root element is the one we write ourselves */
+	while ((res = xmlTextReaderRead(reader)) == 1 && xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT)
+		;
+	if (res != 1 || strcmp((const char *)xmlTextReaderConstName(reader), "divelog")) {
+		xmlFreeTextReader(reader);
+		return false;
+	}
+
+	state.log = log;
+	state.fingerprints = &fingerprints; // simply use the global table for now
+	reset_all(&state);
+	dive_start(&state);
+
+	res = traverse_stream(reader, &state);
+	xmlFreeTextReader(reader);
+	if (res < 0) {
+		log->clear();
+		return false;
+	}
+	dive_end(&state);
+	*ret = res ? 0 : -1;
+	return true;
+}
+
 int parse_xml_buffer(const char *url, const char *buffer, int, struct divelog *log,
 				const struct xml_params *params)
 {
 	xmlDoc *doc;
-	const char *res = preprocess_divelog_de(buffer);
+	const char *res;
 	int ret = 0;
 	struct parser_state state;
 
+	/*
+	 * On failure the streaming parser has to undo what it added,
+	 * so only use it when loading into an empty log.
+	 */
+	if (xml_streaming && !params && log->dives.empty() && log->trips.empty() && log->sites.empty() &&
+	    log->devices.empty() && log->filter_presets.empty() && parse_xml_stream(url, buffer, log, &ret))
+		return ret;
+
+	res = preprocess_divelog_de(buffer);
 	state.log = log;
 	state.fingerprints = &fingerprints; // simply use the global table for now
 	doc = xmlReadMemory(res, strlen(res), url, NULL, XML_PARSE_HUGE);
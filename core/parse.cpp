@@ -186,6 +186,7 @@ void dive_site_end(struct parser_state *state)
 
 	struct dive_site *ds = state->log->sites.alloc_or_get(state->cur_dive_site->uuid);
 	ds->merge(*state->cur_dive_site);
+	state->log->sites.location_changed(ds);
 
 	if (verbose > 3)
 		printf("completed dive site uuid %x8 name {%s}\n", ds->uuid, ds->name.c_str());
@@ -449,6 +450,7 @@ void add_dive_site(const char *ds_name, struct dive *dive, struct parser_state *
 					} else {
 						newds->location = ds->location;
 					}
+					state->log->sites.location_changed(newds);
 					newds->notes += '\n';
 					newds->notes += format_string_std(translate("gettextFromC", "additional name for site: %s\n"), ds->name.c_str());
 				}
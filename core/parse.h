@@ -142,6 +142,7 @@ void nonmatch(const char *type, const char *name, char *buffer);
 
 void parse_xml_init();
 int parse_xml_buffer(const char *url, const char *buf, int size, struct divelog *log, const struct xml_params *params);
+void set_xml_streaming(bool streaming);
 void parse_xml_exit();
 int parse_dm4_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct divelog *log);
 int parse_dm5_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct divelog *log);
@@ -29,13 +29,13 @@
 
 static constexpr int base_timestep = 2; // seconds
 
-static int decostoplevels_metric[] = { 0, 3000, 6000, 9000, 12000, 15000, 18000, 21000, 24000, 27000,
+static const int decostoplevels_metric[] = { 0, 3000, 6000, 9000, 12000, 15000, 18000, 21000, 24000, 27000,
 					30000, 33000, 36000, 39000, 42000, 45000, 48000, 51000, 54000, 57000,
 					60000, 63000, 66000, 69000, 72000, 75000, 78000, 81000, 84000, 87000,
 					90000, 100000, 110000, 120000, 130000, 140000, 150000, 160000, 170000,
 					180000, 190000, 200000, 220000, 240000, 260000, 280000, 300000,
 					320000, 340000, 360000, 380000 };
-static int decostoplevels_imperial[] = { 0, 3048, 6096, 9144, 12192, 15240, 18288, 21336, 24384, 27432,
+static const int decostoplevels_imperial[] = { 0, 3048, 6096, 9144, 12192, 15240, 18288, 21336, 24384, 27432,
 					30480, 33528, 36576, 39624, 42672, 45720, 48768, 51816, 54864, 57912,
 					60960, 64008, 67056, 70104, 73152, 76200, 79248, 82296, 85344, 88392,
 					91440, 101600, 111760, 121920, 132080, 142240, 152400, 162560, 172720,
@@ -617,8 +617,7 @@ std::vector<decostop> plan(struct deco_state *ds, struct diveplan &diveplan, str
 	int current_cylinder, stop_cylinder;
 	size_t stopidx;
 	int depth;
-	int *decostoplevels;
-	size_t decostoplevelcount;
+	std::vector<int> decostoplevels;
 	std::vector<int> stoplevels;
 	bool stopping = false;
 	bool pendinggaschange = false;
@@ -637,8 +636,9 @@ std::vector<decostop> plan(struct deco_state *ds, struct diveplan &diveplan, str
 	struct divecomputer *dc = dive->get_dc(dcNr);
 	enum divemode_t divemode = dc->divemode;
 
-	set_gf(diveplan.gflow, diveplan.gfhigh);
-	set_vpmb_conservatism(diveplan.vpmb_conservatism);
+	/* The settings of the plan live in the deco state, so that plans can be computed concurrently */
+	ds->settings.set_gf(diveplan.gflow, diveplan.gfhigh);
+	ds->settings.set_vpmb_conservatism(diveplan.vpmb_conservatism);
 
 	if (diveplan.surface_pressure.mbar == 0) {
 		// Lets use dive's surface pressure in planner, if have one...
@@ -656,22 +656,14 @@ std::vector<decostop> plan(struct deco_state *ds, struct diveplan &diveplan, str
 	create_dive_from_plan(diveplan, dive, dc, is_planner);
 
 	// Do we want deco stop array in metres or feet?
-	if (prefs.units.length == units::METERS ) {
-		decostoplevels = decostoplevels_metric;
-		decostoplevelcount = std::size(decostoplevels_metric);
-	} else {
-		decostoplevels = decostoplevels_imperial;
-		decostoplevelcount = std::size(decostoplevels_imperial);
-	}
+	if (prefs.units.length == units::METERS )
+		decostoplevels.assign(std::begin(decostoplevels_metric), std::end(decostoplevels_metric));
+	else
+		decostoplevels.assign(std::begin(decostoplevels_imperial), std::end(decostoplevels_imperial));
 
-	/* If the user has selected last stop to be at 6m/20', we need to get rid of the 3m/10' stop.
-	 * Otherwise reinstate the last stop 3m/10' stop.
-	 * Remark: not reentrant, but the user probably won't change preferences while this is running.
-	 */
+	/* If the user has selected last stop to be at 6m/20', we need to get rid of the 3m/10' stop. */
 	if (prefs.last_stop)
-		*(decostoplevels + 1) = 0;
-	else
-		*(decostoplevels + 1) = M_OR_FT(3,10);
+		decostoplevels[1] = 0;
 
 	/* Let's start at the last 'sample', i.e. the last manually entered waypoint. */
 	const struct sample &sample = dc->samples.back();
@@ -716,13 +708,13 @@ std::vector<decostop> plan(struct deco_state *ds, struct diveplan &diveplan, str
 	}
 
 	/* Find the first potential decostopdepth above current depth */
-	for (stopidx = 0; stopidx < decostoplevelcount; stopidx++)
+	for (stopidx = 0; stopidx < decostoplevels.size(); stopidx++)
 		if (decostoplevels[stopidx] > depth)
 			break;
 	if (stopidx > 0)
 		stopidx--;
 	/* Stoplevels are either depths of gas changes or potential deco stop depths. */
-	stoplevels = sort_stops(decostoplevels, stopidx + 1, gaschanges);
+	stoplevels = sort_stops(decostoplevels.data(), stopidx + 1, gaschanges);
 	stopidx += gaschanges.size();
 
 	gi = static_cast<int>(gaschanges.size()) - 1;
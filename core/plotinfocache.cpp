@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "plotinfocache.h"
+#include "dive.h"
+#include "subsurface-qt/divelistnotifier.h"
+
+#include <algorithm>
+
+// A one-hour dive with a two-second sample rate takes about 1 MB.
+static const size_t default_max_size = 128 * 1024 * 1024;
+
+static size_t plot_info_size(const plot_info &pi)
+{
+	size_t res = sizeof(pi);
+	res += pi.entry.capacity() * sizeof(plot_data);
+	res += pi.pressures.capacity() * sizeof(plot_pressure_data);
+	res += pi.deco_checkpoints.capacity() * sizeof(plot_deco_checkpoint);
+	for (const std::vector<int> &v: pi.tissue_ceilings)
+		res += v.capacity() * sizeof(int);
+	for (const std::vector<int> &v: pi.tissue_percentages)
+		res += v.capacity() * sizeof(int);
+	return res;
+}
+
+PlotInfoCache::PlotInfoCache() : totalSize(0), maxSize(default_max_size)
+{
+	// The deco of a dive depends on the preceding dives. Therefore, changing a
+	// dive invalidates the plot infos of all dives starting at that dive.
+	// Changes that may reorder the dives drop the whole cache.
+	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &PlotInfoCache::clear);
+	connect(&diveListNotifier, &DiveListNotifier::divesImported, this, &PlotInfoCache::clear);
+	connect(&diveListNotifier, &DiveListNotifier::divesTimeChanged, this, &PlotInfoCache::clear);
+	connect(&diveListNotifier, &DiveListNotifier::diveComputerEdited, this, &PlotInfoCache::clear);
+	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this,
+		[this](dive_trip *, bool, const QVector<dive *> &dives) { invalidate(dives); });
+	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this,
+		[this](dive_trip *, bool, const QVector<dive *> &dives) { invalidate(dives); });
+	connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips, this,
+		[this](dive_trip *, dive_trip *, bool, bool, const QVector<dive *> &dives) { invalidate(dives); });
+	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this,
+		[this](const QVector<dive *> &dives, DiveField) { invalidate(dives); });
+	connect(&diveListNotifier, &DiveListNotifier::cylindersReset, this, &PlotInfoCache::invalidate);
+	connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, this, [this](dive *d, int) { invalidate({ d }); });
+	connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, this, [this](dive *d, int) { invalidate({ d }); });
+	connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, this, [this](dive *d, int) { invalidate({ d }); });
+	connect(&diveListNotifier, &DiveListNotifier::eventsChanged, this, [this](dive *d) { invalidate({ d }); });
+}
+
+PlotInfoCache *PlotInfoCache::instance()
+{
+	static PlotInfoCache self;
+	return &self;
+}
+
+std::list<PlotInfoCache::Entry>::iterator PlotInfoCache::lookup(const struct dive *d, int dc, uint64_t prefsHash)
+{
+	auto it = std::find_if(entries.begin(), entries.end(), [d, dc, prefsHash](const Entry &e)
+			       { return e.d == d && e.id == d->id && e.dc == dc && e.prefsHash == prefsHash; });
+	if (it != entries.end())
+		entries.splice(entries.begin(), entries, it);
+	return it;
+}
+
+std::optional<plot_info> PlotInfoCache::find(const struct dive *d, int dc)
+{
+	uint64_t prefsHash = plot_info_prefs_hash();
+	std::lock_guard<std::mutex> guard(lock);
+	auto it = lookup(d, dc, prefsHash);
+	if (it == entries.end())
+		return {};
+	return it->pi;
+}
+
+void PlotInfoCache::put(const struct dive *d, int dc, plot_info pi)
+{
+	put(d, dc, std::move(pi), plot_info_prefs_hash());
+}
+
+void PlotInfoCache::put(const struct dive *d, int dc, plot_info pi, uint64_t prefsHash)
+{
+	size_t size = plot_info_size(pi);
+	std::lock_guard<std::mutex> guard(lock);
+	auto it = lookup(d, dc, prefsHash);
+	if (it != entries.end()) {
+		totalSize -= it->size;
+		it->size = size;
+		it->pi = std::move(pi);
+	} else {
+		entries.push_front({ d, d->id, dc, prefsHash, d->when, size, std::move(pi) });
+	}
+	totalSize += size;
+	evict();
+}
+
+plot_info PlotInfoCache::get(const struct dive *d, int dc, const plot_info *previous)
+{
+	if (std::optional<plot_info> pi = find(d, dc))
+		return std::move(*pi);
+	plot_info pi = create_plot_info_new(d, d->get_dc(dc), nullptr, previous);
+	put(d, dc, pi);
+	return pi;
+}
+
+// Called with the lock held. The most recently used entry is always kept.
+void PlotInfoCache::evict()
+{
+	while (totalSize > maxSize && entries.size() > 1) {
+		totalSize -= entries.back().size;
+		entries.pop_back();
+	}
+}
+
+void PlotInfoCache::invalidate(const QVector<dive *> &dives)
+{
+	if (dives.isEmpty())
+		return;
+	timestamp_t first = (*std::min_element(dives.begin(), dives.end(),
+			     [](const dive *d1, const dive *d2) { return d1->when < d2->when; }))->when;
+	std::lock_guard<std::mutex> guard(lock);
+	for (auto it = entries.begin(); it != entries.end(); ) {
+		if (it->when >= first || dives.contains(const_cast<dive *>(it->d))) {
+			totalSize -= it->size;
+			it = entries.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void PlotInfoCache::clear()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	entries.clear();
+	totalSize = 0;
+}
+
+void PlotInfoCache::setMaxSize(size_t bytes)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	maxSize = bytes;
+	evict();
+}
+
+size_t PlotInfoCache::size() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return totalSize;
+}
+
+int PlotInfoCache::count() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return static_cast<int>(entries.size());
+}
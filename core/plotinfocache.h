@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0
+// A memory-bounded LRU cache of plot infos, so that the profile, printing
+// and the profile data export don't recalculate the deco of the same dive.
+#ifndef PLOTINFOCACHE_H
+#define PLOTINFOCACHE_H
+
+#include "profile.h"
+
+#include <QObject>
+#include <QVector>
+#include <list>
+#include <mutex>
+#include <optional>
+
+struct dive;
+
+class PlotInfoCache : public QObject {
+	Q_OBJECT
+public:
+	static PlotInfoCache *instance();
+
+	// Returns the plot info of a dive computer outside of the planner.
+	// On a cache miss, the plot info is calculated and added to the cache.
+	// If previous is given, the calculation resumes from its deco checkpoints.
+	plot_info get(const struct dive *d, int dc, const plot_info *previous = nullptr);
+
+	// Returns nothing on a cache miss.
+	std::optional<plot_info> find(const struct dive *d, int dc);
+	void put(const struct dive *d, int dc, plot_info pi);
+	// Same, but for a plot info that was calculated with the preferences
+	// of the given plot_info_prefs_hash(), which may have changed since.
+	void put(const struct dive *d, int dc, plot_info pi, uint64_t prefsHash);
+
+	void clear();
+	void setMaxSize(size_t bytes);
+	size_t size() const; // Approximate memory use of the cached plot infos in bytes
+	int count() const;
+private:
+	struct Entry {
+		const struct dive *d;
+		int id; // To detect reuse of freed dives
+		int dc;
+		uint64_t prefsHash;
+		timestamp_t when;
+		size_t size;
+		plot_info pi;
+	};
+
+	PlotInfoCache();
+	std::list<Entry>::iterator lookup(const struct dive *d, int dc, uint64_t prefsHash);
+	void evict();
+	void invalidate(const QVector<dive *> &dives);
+
+	mutable std::mutex lock;
+	std::list<Entry> entries; // Most recently used first
+	size_t totalSize;
+	size_t maxSize;
+};
+
+#endif
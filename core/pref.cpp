@@ -23,6 +23,7 @@ preferences::preferences() :
 	include_unused_tanks(false),
 	display_default_tank_infos(true),
 	auto_recalculate_thumbnails(true),
+	thumbnail_threads(0),
 	extract_video_thumbnails(true),
 	extract_video_thumbnails_position(20),		// The first fifth seems like a reasonable place
 	defaultsetpoint(1100),
@@ -32,6 +33,7 @@ preferences::preferences() :
 	use_default_file(true),
 	extraEnvironmentalDefault(false),
 	salinityEditDefault(false),
+	git_binary_samples(false),
 	date_format_override(false),
 	time_format_override(false),
 	proxy_auth(false),
@@ -51,6 +53,10 @@ preferences::preferences() :
 	display_runtime(true),
 	display_transitions(true),
 	display_variations(false),
+	variations_depth_steps(1),
+	variations_time_steps(1),
+	variations_gf_steps(0),
+	variations_table(false),
 	doo2breaks(false),
 	dobailout(false),
 	o2narcotic(true),
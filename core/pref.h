@@ -110,6 +110,7 @@ struct preferences {
 
 	// ********** General **********
 	bool        auto_recalculate_thumbnails;
+	int         thumbnail_threads; // thumbnails calculated concurrently, 0: automatic
 	bool	    extract_video_thumbnails;
 	int	    extract_video_thumbnails_position; // position in stream: 0=first 100=last second
 	std::string ffmpeg_executable; // path of ffmpeg binary
@@ -121,6 +122,7 @@ struct preferences {
 	bool        use_default_file;
 	bool        extraEnvironmentalDefault;
 	bool        salinityEditDefault;
+	bool        git_binary_samples; // not readable by older versions
 
 	// ********** Geocoding **********
 	geocoding_prefs_t geocoding;
@@ -156,6 +158,10 @@ struct preferences {
 	bool            display_runtime;
 	bool            display_transitions;
 	bool            display_variations;
+	int             variations_depth_steps; // each step is one depth unit
+	int             variations_time_steps; // each step is one minute
+	int             variations_gf_steps; // each step is five percentage points
+	bool            variations_table; // list all combinations
 	bool            doo2breaks;
 	bool            dobailout;
 	bool		o2narcotic;
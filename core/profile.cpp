@@ -16,6 +16,7 @@
 #include "interpolate.h"
 #include "sample.h"
 #include "subsurface-string.h"
+#include "subsurface-hash.h"
 
 #include "profile.h"
 #include "gaspressures.h"
@@ -834,10 +835,113 @@ static void calculate_ndl_tts(struct deco_state *ds, const struct dive *dive, st
 	}
 }
 
+/*
+ * Incremental deco calculation: while walking the plot entries, we store a snapshot
+ * of the deco state every DECO_CHECKPOINT_INTERVAL seconds together with a hash of
+ * all inputs that went into it. When recalculating a profile (e.g. after editing
+ * an event or a sample), we can resume from the last snapshot with unchanged inputs.
+ * This is only done for Bühlmann outside of the planner, since VPM-B iterates
+ * over the whole dive.
+ */
+#define DECO_CHECKPOINT_INTERVAL 300
+
+/* Hash of the preferences read by calculate_ndl_tts() */
+static uint64_t hash_ndl_tts_prefs(uint64_t hash)
+{
+	hash = hash_value(hash, (int)prefs.calcndltts);
+	hash = hash_value(hash, (int)prefs.units.length); // deco step size
+	hash = hash_value(hash, prefs.ascrate75);
+	hash = hash_value(hash, prefs.ascrate50);
+	hash = hash_value(hash, prefs.ascratestops);
+	hash = hash_value(hash, prefs.ascratelast6m);
+	hash = hash_value(hash, prefs.bottomsac);
+	hash = hash_value(hash, prefs.decosac);
+	return hash;
+}
+
+/* Hash of everything the deco calculation depends on, apart from the plot entries */
+static uint64_t deco_input_seed(const struct deco_state *ds, const struct dive *dive, double surface_pressure)
+{
+	uint64_t hash = hash_seed;
+	for (int ci = 0; ci < 16; ci++) {
+		hash = hash_value(hash, ds->tissue_n2_sat[ci]);
+		hash = hash_value(hash, ds->tissue_he_sat[ci]);
+	}
+	hash = hash_value(hash, ds->gf_low_pressure_this_dive);
+	hash = hash_value(hash, surface_pressure);
+	hash = hash_value(hash, ds->settings.gf_low);
+	hash = hash_value(hash, ds->settings.gf_high);
+	hash = hash_value(hash, dive->rel_mbar_to_depth(10000)); // depends on salinity
+	hash = hash_value(hash, (int)prefs.calcceiling3m);
+	return hash_ndl_tts_prefs(hash);
+}
+
+/* Returns a vector of nr + 1 hashes, where entry i covers the inputs of plot entries [0, i) */
+static std::vector<uint64_t> hash_deco_inputs(const struct dive *dive, const struct divecomputer *dc, const struct plot_info &pi, uint64_t seed)
+{
+	std::vector<uint64_t> res;
+	res.reserve(pi.nr + 1);
+	res.push_back(seed);
+
+	gasmix_loop loop(*dive, *dc);
+	divemode_loop loop_d(*dc);
+	uint64_t hash = seed;
+	for (const struct plot_data &entry: pi.entry) {
+		struct gasmix gasmix = loop.at(entry.sec).first;
+		hash = hash_value(hash, entry.sec);
+		hash = hash_value(hash, entry.depth);
+		hash = hash_value(hash, entry.running_sum);
+		hash = hash_value(hash, entry.ndl);
+		hash = hash_value(hash, entry.sac);
+		hash = hash_value(hash, entry.o2pressure.mbar);
+		hash = hash_value(hash, gasmix.o2.permille);
+		hash = hash_value(hash, gasmix.he.permille);
+		hash = hash_value(hash, (int)loop_d.at(entry.sec));
+		res.push_back(hash);
+	}
+	return res;
+}
+
+/* Find the last checkpoint of a previous calculation that can be reused */
+static const struct plot_deco_checkpoint *find_deco_checkpoint(const struct plot_info &previous, const std::vector<uint64_t> &input_hashes)
+{
+	const struct plot_deco_checkpoint *res = nullptr;
+	for (const auto &checkpoint: previous.deco_checkpoints) {
+		if (checkpoint.idx >= (int)input_hashes.size() - 1 ||
+		    checkpoint.input_hash != input_hashes[checkpoint.idx])
+			break;
+		res = &checkpoint;
+	}
+	return res;
+}
+
+/* Copy the results of calculate_deco_information() for one entry */
+static void copy_deco_information(struct plot_info &pi, const struct plot_info &from_pi, int idx)
+{
+	struct plot_data &entry = pi.entry[idx];
+	const struct plot_data &from = from_pi.entry[idx];
+	for (int j = 0; j < 16; j++) {
+		pi.tissue_ceilings[j][idx] = from_pi.tissue_ceilings[j][idx];
+		pi.tissue_percentages[j][idx] = from_pi.tissue_percentages[j][idx];
+	}
+	entry.ambpressure = from.ambpressure;
+	entry.gfline = from.gfline;
+	entry.icd_warning = from.icd_warning;
+	entry.ceiling = from.ceiling;
+	entry.surface_gf = from.surface_gf;
+	entry.current_gf = from.current_gf;
+	entry.ndl = from.ndl;
+	entry.in_deco_calc = from.in_deco_calc;
+	entry.ndl_calc = from.ndl_calc;
+	entry.tts_calc = from.tts_calc;
+	entry.stoptime_calc = from.stoptime_calc;
+	entry.stopdepth_calc = from.stopdepth_calc;
+}
+
 /* Let's try to do some deco calculations.
  */
 static void calculate_deco_information(struct deco_state *ds, const struct deco_state *planner_ds, const struct dive *dive,
-				       const struct divecomputer *dc, struct plot_info &pi)
+				       const struct divecomputer *dc, struct plot_info &pi, const struct plot_info *previous)
 {
 	int i, count_iteration = 0;
 	double surface_pressure = (dc->surface_pressure.mbar ? dc->surface_pressure.mbar : dive->get_surface_pressure().mbar) / 1000.0;
@@ -852,8 +956,19 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 		ds->deco_time = planner_ds->deco_time;
 		ds->first_ceiling_pressure = planner_ds->first_ceiling_pressure;
 	}
+	for (int j = 0; j < 16; j++) {
+		pi.tissue_ceilings[j].assign(pi.nr, 0);
+		pi.tissue_percentages[j].assign(pi.nr, 0);
+	}
 	deco_state_cache cache_data_initial;
-	lock_planner();
+	bool incremental = !in_planner && decoMode(in_planner) != VPMB;
+	std::vector<uint64_t> input_hashes;
+	const struct plot_deco_checkpoint *resume = nullptr;
+	if (incremental) {
+		input_hashes = hash_deco_inputs(dive, dc, pi, deco_input_seed(ds, dive, surface_pressure));
+		if (previous)
+			resume = find_deco_checkpoint(*previous, input_hashes);
+	}
 	/* For VPM-B outside the planner, cache the initial deco state for CVA iterations */
 	if (decoMode(in_planner) == VPMB) {
 		cache_data_initial.cache(ds);
@@ -866,14 +981,31 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 		if (decoMode(in_planner) == VPMB)
 			ds->first_ceiling_pressure.mbar = dive->depth_to_mbar(first_ceiling);
 
+		int start = 1, next_checkpoint_time = DECO_CHECKPOINT_INTERVAL;
+		if (resume) {
+			for (i = 1; i < resume->idx; i++)
+				copy_deco_information(pi, *previous, i);
+			pi.deco_checkpoints.assign(previous->deco_checkpoints.begin(),
+						   previous->deco_checkpoints.begin() + (resume - previous->deco_checkpoints.data()) + 1);
+			*ds = resume->ds;
+			last_ndl_tts_calc_time = resume->last_ndl_tts_calc_time;
+			start = resume->idx;
+			next_checkpoint_time = pi.entry[start].sec + DECO_CHECKPOINT_INTERVAL;
+		}
+
 		gasmix_loop loop(*dive, *dc);
 		divemode_loop loop_d(*dc);
-		for (i = 1; i < pi.nr; i++) {
+		for (i = start; i < pi.nr; i++) {
 			struct plot_data &entry = pi.entry[i];
 			struct plot_data &prev = pi.entry[i - 1];
 			int j, t0 = prev.sec, t1 = entry.sec;
 			int time_stepsize = 20, max_ceiling = -1;
 
+			if (incremental && entry.sec >= next_checkpoint_time) {
+				pi.deco_checkpoints.push_back({ i, input_hashes[i], last_ndl_tts_calc_time, *ds });
+				next_checkpoint_time = entry.sec + DECO_CHECKPOINT_INTERVAL;
+			}
+
 			divemode_t current_divemode = loop_d.at(entry.sec);
 			struct gasmix gasmix = loop.at(t1).first;
 			entry.ambpressure = dive->depth_to_bar(entry.depth);
@@ -939,11 +1071,12 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 			for (j = 0; j < 16; j++) {
 				double m_value = ds->buehlmann_inertgas_a[j] + entry.ambpressure / ds->buehlmann_inertgas_b[j];
 				double surface_m_value = ds->buehlmann_inertgas_a[j] + surface_pressure / ds->buehlmann_inertgas_b[j];
-				entry.ceilings[j] = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
-				if (entry.ceilings[j] > max_ceiling)
-					max_ceiling = entry.ceilings[j];
+				int ceiling = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
+				pi.tissue_ceilings[j][i] = ceiling;
+				if (ceiling > max_ceiling)
+					max_ceiling = ceiling;
 				double current_gf = (ds->tissue_inertgas_saturation[j] - entry.ambpressure) / (m_value - entry.ambpressure);
-				entry.percentages[j] = ds->tissue_inertgas_saturation[j] < entry.ambpressure ?
+				pi.tissue_percentages[j][i] = ds->tissue_inertgas_saturation[j] < entry.ambpressure ?
 					lrint(ds->tissue_inertgas_saturation[j] / entry.ambpressure * AMB_PERCENTAGE) :
 					lrint(AMB_PERCENTAGE + current_gf * (100.0 - AMB_PERCENTAGE));
 				if (current_gf > entry.current_gf)
@@ -1024,7 +1157,6 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 #if DECO_CALC_DEBUG & 1
 	dump_tissues(ds);
 #endif
-	unlock_planner();
 }
 
 /* Sort the o2 pressure values. There are so few that a simple bubble sort
@@ -1216,11 +1348,21 @@ static void debug_print_profiledata(struct plot_info &pi)
  *
  * The old data will be freed.
  */
-struct plot_info create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, const struct deco_state *planner_ds)
+struct plot_info create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, const struct deco_state *planner_ds,
+				      const struct plot_info *previous)
+{
+	struct deco_settings settings = planner_ds ? planner_ds->settings : default_deco_settings();
+	return create_plot_info_new(divelog.dives, settings, dive, dc, planner_ds, previous);
+}
+
+struct plot_info create_plot_info_new(const struct dive_table &dives, const struct deco_settings &settings, const struct dive *dive,
+				      const struct divecomputer *dc, const struct deco_state *planner_ds,
+				      const struct plot_info *previous)
 {
 	struct deco_state plot_deco_state;
 	bool in_planner = planner_ds != NULL;
-	divelog.dives.init_decompression(&plot_deco_state, dive, in_planner);
+	plot_deco_state.settings = settings;
+	dives.init_decompression(&plot_deco_state, dive, in_planner);
 	plot_info pi;
 	calculate_max_limits_new(dive, dc, pi, in_planner);
 	auto [o2, he, o2max ] = dive->get_maximal_gas();
@@ -1244,7 +1386,7 @@ struct plot_info create_plot_info_new(const struct dive *dive, const struct dive
 	fill_o2_values(dive, dc, pi);			 /* .. and insert the O2 sensor data having 0 values. */
 	calculate_sac(dive, dc, pi);			 /* Calculate sac */
 
-	calculate_deco_information(&plot_deco_state, planner_ds, dive, dc, pi); /* and ceiling information, using gradient factor values in Preferences) */
+	calculate_deco_information(&plot_deco_state, planner_ds, dive, dc, pi, previous); /* and ceiling information, using gradient factor values in Preferences) */
 
 	calculate_gas_information_new(dive, dc, pi);	 /* Calculate gas partial pressures */
 
@@ -1257,6 +1399,27 @@ struct plot_info create_plot_info_new(const struct dive *dive, const struct dive
 	return pi;
 }
 
+uint64_t plot_info_prefs_hash()
+{
+	return plot_info_prefs_hash(default_deco_settings());
+}
+
+uint64_t plot_info_prefs_hash(const struct deco_settings &settings)
+{
+	uint64_t hash = hash_seed;
+	hash = hash_value(hash, (int)decoMode(false));
+	hash = hash_value(hash, settings.gf_low);
+	hash = hash_value(hash, settings.gf_high);
+	hash = hash_value(hash, (int)settings.vpmb_conservatism);
+	hash = hash_value(hash, (int)prefs.calcceiling3m);
+	hash = hash_ndl_tts_prefs(hash);
+	hash = hash_value(hash, prefs.o2consumption);
+	hash = hash_value(hash, prefs.pscr_ratio);
+	hash = hash_value(hash, prefs.modpO2);
+	hash = hash_value(hash, (int)prefs.o2narcotic);
+	return hash;
+}
+
 static std::vector<std::string> plot_string(const struct dive *d, const struct plot_info &pi, int idx)
 {
 	int pressurevalue, mod, ead, end, eadd;
@@ -1394,8 +1557,9 @@ static std::vector<std::string> plot_string(const struct dive *d, const struct p
 			if (prefs.calcalltissues) {
 				int k;
 				for (k = 0; k < 16; k++) {
-					if (entry.ceilings[k]) {
-						depthvalue = get_depth_units(entry.ceilings[k], NULL, &depth_unit);
+					int ceiling = get_plot_tissue_ceiling(pi, idx, k);
+					if (ceiling) {
+						depthvalue = get_depth_units(ceiling, NULL, &depth_unit);
 						res.push_back(casprintf_loc(translate("gettextFromC", "Tissue %.0fmin: %.1f%s"), buehlmann_N2_t_halflife[k], depthvalue, depth_unit));
 					}
 				}
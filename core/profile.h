@@ -2,6 +2,7 @@
 #ifndef PROFILE_H
 #define PROFILE_H
 
+#include "deco.h" // deco_state
 #include "gas.h" // gas_pressures
 #include "sample.h" // MAX_O2_SENSORS
 
@@ -25,8 +26,8 @@ enum plot_pressure {
 };
 
 struct membuffer;
-struct deco_state;
 struct dive;
+struct dive_table;
 struct divecomputer;
 
 /*
@@ -43,8 +44,6 @@ struct plot_data {
 	/* Depth info */
 	int depth = 0;
 	int ceiling = 0;
-	std::array<int, 16> ceilings;
-	std::array<int, 16> percentages;
 	int ndl = 0;
 	int tts = 0;
 	int rbt = 0;
@@ -80,6 +79,19 @@ struct plot_data {
 	bool icd_warning = false;
 };
 
+/*
+ * Snapshot of the deco state taken while calculating the deco information.
+ * The state is the one before processing entry idx and input_hash covers
+ * the deco-relevant inputs of entries [0, idx). If a later calculation finds
+ * the same hash, it may resume at idx instead of starting from scratch.
+ */
+struct plot_deco_checkpoint {
+	int idx;
+	uint64_t input_hash;
+	int last_ndl_tts_calc_time;
+	struct deco_state ds;
+};
+
 /* Plot info with smoothing, velocity indication
  * and one-, two- and three-minute minimums and maximums */
 struct plot_info {
@@ -96,6 +108,11 @@ struct plot_info {
 	bool waypoint_above_ceiling = false;
 	std::vector<plot_data> entry;
 	std::vector<plot_pressure_data> pressures; /* cylinders.size() blocks of nr entries. */
+	/* The per-tissue data are kept out of plot_data, one column of nr entries per
+	 * tissue. Otherwise, every pass over the entries would drag them through the cache. */
+	std::array<std::vector<int>, 16> tissue_ceilings;
+	std::array<std::vector<int>, 16> tissue_percentages;
+	std::vector<plot_deco_checkpoint> deco_checkpoints; /* only for Bühlmann outside of the planner */
 
 	plot_info();
 	~plot_info();
@@ -107,8 +124,21 @@ struct plot_info {
 
 #define AMB_PERCENTAGE 50.0
 
-/* when planner_dc is non-null, this is called in planner mode. */
-extern struct plot_info create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, const struct deco_state *planner_ds);
+/* when planner_dc is non-null, this is called in planner mode.
+ * If previous is non-null, the deco calculation resumes from the last
+ * checkpoint of previous whose inputs are unchanged. */
+extern struct plot_info create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, const struct deco_state *planner_ds,
+					     const struct plot_info *previous = nullptr);
+/* Same, but the previous dives are taken from the given table instead of the
+ * global dive list, e.g. from a dive_table::deco_snapshot(), and the given
+ * deco settings are used instead of the ones of the planner or the preferences */
+extern struct plot_info create_plot_info_new(const struct dive_table &dives, const struct deco_settings &settings, const struct dive *dive,
+					     const struct divecomputer *dc, const struct deco_state *planner_ds,
+					     const struct plot_info *previous = nullptr);
+/* Hash of the preferences that the plot info depends on */
+extern uint64_t plot_info_prefs_hash();
+/* Same, but with the given deco settings instead of the ones of the preferences */
+extern uint64_t plot_info_prefs_hash(const struct deco_settings &settings);
 
 /*
  * When showing dive profiles, we scale things to the
@@ -149,6 +179,16 @@ static inline int get_plot_pressure(const struct plot_info &pi, int idx, int cyl
 	return res ? res : get_plot_interpolated_pressure(pi, idx, cylinder);
 }
 
+static inline int get_plot_tissue_ceiling(const struct plot_info &pi, int idx, int tissue)
+{
+	return pi.tissue_ceilings[tissue][idx];
+}
+
+static inline int get_plot_tissue_percentage(const struct plot_info &pi, int idx, int tissue)
+{
+	return pi.tissue_percentages[tissue][idx];
+}
+
 // Returns index of sample and array of strings describing the dive details at given time
 std::pair<int, std::vector<std::string>> get_plot_details_new(const struct dive *d, const struct plot_info &pi, int time);
 std::vector<std::string> compare_samples(const struct dive *d, const struct plot_info &pi, int idx1, int idx2, bool sum);
@@ -22,6 +22,7 @@
 #include "selection.h"
 #include "tag.h"
 #include "imagedownloader.h"
+#include "thumbnailstore.h"
 #include "xmlparams.h"
 #include <QFile>
 #include <QRegularExpression>
@@ -971,19 +972,28 @@ std::string hashfile_name()
 	return std::string(system_default_directory()) + "/hashes";
 }
 
-static QString thumbnailDir()
+QString thumbnailDir()
 {
 	return QString::fromStdString(system_default_directory() + "/thumbnails/");
 }
 
+// Key of a thumbnail in the thumbnail store: the hash of the name of the file.
+QByteArray thumbnailHash(const QString &filename)
+{
+	if (filename.isEmpty())
+		return QByteArray();
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(filename.toUtf8());
+	return hash.result();
+}
+
 // Calculate thumbnail filename by hashing name of file.
+// Only used to read thumbnails written before the thumbnail store existed.
 QString thumbnailFileName(const QString &filename)
 {
 	if (filename.isEmpty())
 		return QString();
-	QCryptographicHash hash(QCryptographicHash::Sha1);
-	hash.addData(filename.toUtf8());
-	return thumbnailDir() + hash.result().toHex();
+	return thumbnailDir() + thumbnailHash(filename).toHex();
 }
 
 // TODO: This is a temporary helper struct. Remove in due course with convertLocalFilename().
@@ -1065,6 +1075,8 @@ void write_hashes()
 	} else {
 		qWarning() << "Cannot open hashfile for writing: " << hashfile.fileName();
 	}
+	locker.unlock();
+	ThumbnailStore::instance()->writeIndex();
 }
 
 void learnPictureFilename(const QString &originalName, const QString &localName)
@@ -1511,18 +1523,6 @@ void print_qt_versions()
 	printf("%s\n", qPrintable(QStringLiteral("built with Qt Version %1, runtime from Qt Version %2").arg(QT_VERSION_STR).arg(qVersion())));
 }
 
-QMutex planLock;
-
-void lock_planner()
-{
-	planLock.lock();
-}
-
-void unlock_planner()
-{
-	planLock.unlock();
-}
-
 // function to call to allow the UI to show updates for longer running activities
 void (*uiNotificationCallback)(QString msg) = nullptr;
 
@@ -14,7 +14,11 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <git2.h>
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <unordered_map>
 
 #include "dive.h"
 #include "divelog.h"
@@ -220,7 +224,8 @@ static void show_date(struct membuffer *b, timestamp_t when)
 
 static void show_integer(struct membuffer *b, int value, const char *pre, const char *post)
 {
-	put_format(b, " %s%d%s", pre, value, post);
+	put_string(b, " ");
+	put_int(b, pre, value, post);
 }
 
 static void show_index(struct membuffer *b, int value, const char *pre, const char *post)
@@ -239,7 +244,7 @@ static void save_sample(struct membuffer *b, const struct sample &sample, struct
 {
 	int idx;
 
-	put_format(b, "%3u:%02u", FRACTION_TUPLE(sample.time.seconds, 60));
+	put_minsec(b, "", sample.time.seconds, "", 3);
 	put_milli(b, " ", sample.depth.mm, "m");
 	put_temperature(b, sample.temperature, " ", "°C");
 
@@ -268,7 +273,7 @@ static void save_sample(struct membuffer *b, const struct sample &sample, struct
 			 * mode, and "old.sensor[0]" contains that index.
 			 */
 			if (sensor != old.sensor[0]) {
-				put_format(b, " sensor=%d", sensor);
+				put_int(b, " sensor=", sensor, "");
 				old.sensor[0] = sensor;
 			}
 			continue;
@@ -276,24 +281,24 @@ static void save_sample(struct membuffer *b, const struct sample &sample, struct
 
 		/* The new-style format is much simpler: the sensor is always encoded */
 		put_pressure(b, p, " ", "bar");
-		put_format(b, ":%d", sensor);
+		put_int(b, ":", sensor, "");
 	}
 
 	/* the deco/ndl values are stored whenever they change */
 	if (sample.ndl.seconds != old.ndl.seconds) {
-		put_format(b, " ndl=%u:%02u", FRACTION_TUPLE(sample.ndl.seconds, 60));
+		put_minsec(b, " ndl=", sample.ndl.seconds, "");
 		old.ndl = sample.ndl;
 	}
 	if (sample.tts.seconds != old.tts.seconds) {
-		put_format(b, " tts=%u:%02u", FRACTION_TUPLE(sample.tts.seconds, 60));
+		put_minsec(b, " tts=", sample.tts.seconds, "");
 		old.tts = sample.tts;
 	}
 	if (sample.in_deco != old.in_deco) {
-		put_format(b, " in_deco=%d", sample.in_deco ? 1 : 0);
+		put_int(b, " in_deco=", sample.in_deco ? 1 : 0, "");
 		old.in_deco = sample.in_deco;
 	}
 	if (sample.stoptime.seconds != old.stoptime.seconds) {
-		put_format(b, " stoptime=%u:%02u", FRACTION_TUPLE(sample.stoptime.seconds, 60));
+		put_minsec(b, " stoptime=", sample.stoptime.seconds, "");
 		old.stoptime = sample.stoptime;
 	}
 
@@ -303,12 +308,12 @@ static void save_sample(struct membuffer *b, const struct sample &sample, struct
 	}
 
 	if (sample.cns != old.cns) {
-		put_format(b, " cns=%u%%", sample.cns);
+		put_uint(b, " cns=", sample.cns, "%");
 		old.cns = sample.cns;
 	}
 
 	if (sample.rbt.seconds != old.rbt.seconds) {
-		put_format(b, " rbt=%u:%02u", FRACTION_TUPLE(sample.rbt.seconds, 60));
+		put_minsec(b, " rbt=", sample.rbt.seconds, "");
 		old.rbt.seconds = sample.rbt.seconds;
 	}
 
@@ -354,7 +359,7 @@ static void save_sample(struct membuffer *b, const struct sample &sample, struct
 		show_index(b, sample.bearing.degrees, "bearing=", "°");
 		old.bearing.degrees = sample.bearing.degrees;
 	}
-	put_format(b, "\n");
+	put_string(b, "\n");
 }
 
 static void save_samples(struct membuffer *b, const struct dive &dive, const struct divecomputer &dc)
@@ -373,6 +378,43 @@ static void save_samples(struct membuffer *b, const struct dive &dive, const str
 		save_sample(b, s, dummy, o2sensor);
 }
 
+// Set from the preferences at the start of each save, so that a save is consistent
+static bool git_binary_samples = false;
+
+static void put_varint(struct membuffer *b, int64_t v)
+{
+	uint64_t u = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+	char buf[10];
+	int len = 0;
+
+	do {
+		buf[len++] = (char)((u & 0x7f) | (u >= 0x80 ? 0x80 : 0));
+		u >>= 7;
+	} while (u);
+	put_bytes(b, buf, len);
+}
+
+/* See git-access.h for a description of the format. This has to come last in the blob. */
+static void save_binary_samples(struct membuffer *b, const struct divecomputer &dc)
+{
+	const std::vector<sample> &samples = dc.samples;
+
+	if (samples.empty())
+		return;
+	put_format(b, "binarysamples %d %zu\n", git_binary_samples_version, samples.size());
+	for_each_binary_sample_column([b, &samples](auto get) {
+		int64_t first = get(samples[0]);
+		bool constant = std::all_of(samples.begin(), samples.end(),
+					    [first, &get](const sample &s) { return (int64_t)get(s) == first; });
+		put_varint(b, first);
+		put_varint(b, constant);
+		if (constant)
+			return;
+		for (size_t i = 1; i < samples.size(); i++)
+			put_varint(b, (int64_t)get(samples[i]) - (int64_t)get(samples[i - 1]));
+	});
+}
+
 static void save_one_event(struct membuffer *b, const struct dive &dive, const struct event &ev)
 {
 	put_format(b, "event %d:%02d", FRACTION_TUPLE(ev.time.seconds, 60));
@@ -425,7 +467,110 @@ static void save_dc(struct membuffer *b, const struct dive &dive, const struct d
 
 	save_extra_data(b, dc);
 	save_events(b, dive, dc);
-	save_samples(b, dive, dc);
+	if (git_binary_samples)
+		save_binary_samples(b, dc);
+	else
+		save_samples(b, dive, dc);
+}
+
+/*
+ * A hash of everything that save_dc() writes, so that the blob of an
+ * unchanged dive computer can be reused when only the dive header was
+ * edited. Every step is a bijection of the state, therefore changing
+ * a single value always changes the hash.
+ */
+struct dc_hasher {
+	uint64_t hash = 0xcbf29ce484222325;
+
+	void add(uint64_t v)
+	{
+		hash = (hash ^ v) * 0x100000001b3;
+	}
+
+	void add(const std::string &s)
+	{
+		add(s.size());
+		for (unsigned char c: s)
+			add(c);
+	}
+};
+
+uint64_t dc_git_hash(const struct dive &dive, const struct divecomputer &dc, bool binary_samples)
+{
+	dc_hasher h;
+
+	/* Don't reuse a blob in the wrong format, e.g. when binary samples were turned off */
+	h.add(binary_samples && !dc.samples.empty());
+
+	/* The parts of the dive that save_dc() looks at */
+	h.add(dive.when);
+	h.add(dive.dcs[0].duration.seconds);
+	h.add(dive.cylinders.size());
+	for (auto &cyl: dive.cylinders) {
+		h.add(cyl.gasmix.o2.permille);
+		h.add(cyl.gasmix.he.permille);
+		h.add(cyl.cylinder_use);
+	}
+
+	h.add(dc.model);
+	h.add(dc.last_manual_time.seconds);
+	h.add(dc.deviceid);
+	h.add(dc.diveid);
+	h.add(dc.when);
+	h.add(dc.duration.seconds);
+	h.add(dc.divemode);
+	h.add(dc.no_o2sensors);
+	h.add(dc.maxdepth.mm);
+	h.add(dc.meandepth.mm);
+	h.add(dc.airtemp.mkelvin);
+	h.add(dc.watertemp.mkelvin);
+	h.add(dc.surface_pressure.mbar);
+	h.add(dc.salinity);
+	h.add(dc.surfacetime.seconds);
+
+	h.add(dc.extra_data.size());
+	for (auto &ed: dc.extra_data) {
+		h.add(ed.key);
+		h.add(ed.value);
+	}
+
+	h.add(dc.events.size());
+	for (auto &ev: dc.events) {
+		h.add(ev.time.seconds);
+		h.add(ev.type);
+		h.add(ev.flags);
+		h.add(ev.value);
+		h.add(ev.name);
+		if (ev.is_gaschange()) {
+			h.add(ev.gas.index);
+			h.add(ev.gas.mix.o2.permille);
+			h.add(ev.gas.mix.he.permille);
+		}
+	}
+
+	h.add(dc.samples.size());
+	for (auto &s: dc.samples) {
+		h.add(s.time.seconds);
+		h.add(s.stoptime.seconds);
+		h.add(s.ndl.seconds);
+		h.add(s.tts.seconds);
+		h.add(s.rbt.seconds);
+		h.add(s.depth.mm);
+		h.add(s.stopdepth.mm);
+		h.add(s.temperature.mkelvin);
+		for (int i = 0; i < MAX_SENSORS; i++) {
+			h.add(s.pressure[i].mbar);
+			h.add(s.sensor[i]);
+		}
+		h.add(s.setpoint.mbar);
+		for (int i = 0; i < MAX_O2_SENSORS; i++)
+			h.add(s.o2sensor[i].mbar);
+		h.add(s.bearing.degrees);
+		h.add(s.cns);
+		h.add(s.heartbeat);
+		h.add(s.in_deco);
+	}
+	return h.hash;
 }
 
 /*
@@ -601,13 +746,64 @@ static int blob_insert(git_repository *repo, struct dir *tree, struct membuffer
 	return ret;
 }
 
-static int save_one_divecomputer(git_repository *repo, struct dir *tree, const struct dive &dive, const struct divecomputer &dc, int idx)
+/*
+ * Insert a blob that was already written to the git repo
+ */
+static int blob_id_insert(struct dir *tree, git_oid *blob_id, const char *fmt, ...)
 {
-	int ret;
+	membuffer name;
+
+	VA_BUF(&name, fmt);
+	return tree_insert(tree->files, mb_cstring(&name), 1, blob_id, GIT_FILEMODE_BLOB);
+}
+
+static bool blob_exists(git_repository *repo, const git_oid *id)
+{
+	git_odb *odb;
+	bool res;
+
+	if (git_repository_odb(&odb, repo))
+		return false;
+	res = git_odb_exists(odb, id);
+	git_odb_free(odb);
+	return res;
+}
+
+/*
+ * Write the blob of a dive computer, unless the dive computer didn't change
+ * since it was loaded or last saved. The blob might have been written to a
+ * different repository, therefore check that it exists in this one.
+ */
+static int write_dc_blob(git_repository *repo, const struct dive &dive, struct divecomputer &dc, git_oid *blob_id)
+{
+	static constexpr std::array<unsigned char, 20> null_id = {};
+	uint64_t hash = dc_git_hash(dive, dc, git_binary_samples);
 	membuffer buf;
+	int ret;
+
+	if (dc.git_id != null_id && dc.git_hash == hash) {
+		git_oid_fromraw(blob_id, dc.git_id.data());
+		if (blob_exists(repo, blob_id))
+			return 0;
+	}
 
 	save_dc(&buf, dive, dc);
-	ret = blob_insert(repo, tree, &buf, "Divecomputer%c%03u", idx ? '-' : 0, idx);
+	ret = git_blob_create_frombuffer(blob_id, repo, buf.buffer, buf.len);
+	if (ret)
+		return ret;
+	memcpy(dc.git_id.data(), blob_id->id, dc.git_id.size());
+	dc.git_hash = hash;
+	return 0;
+}
+
+static int save_one_divecomputer(git_repository *repo, struct dir *tree, const struct dive &dive, struct divecomputer &dc, int idx)
+{
+	int ret;
+	git_oid blob_id;
+
+	ret = write_dc_blob(repo, dive, dc, &blob_id);
+	if (!ret)
+		ret = blob_id_insert(tree, &blob_id, "Divecomputer%c%03u", idx ? '-' : 0, idx);
 	if (ret)
 		report_error("divecomputer tree insert failed");
 	return ret;
@@ -646,7 +842,101 @@ static int save_pictures(git_repository *repo, struct dir *dir, const struct div
 	return 0;
 }
 
-static int save_one_dive(git_repository *repo, struct dir *tree, struct dive &dive, struct tm *tm, bool cached_ok)
+/*
+ * Serializing the dives and writing their blobs is the expensive part
+ * of saving, and every dive is dirty after a bulk edit. Therefore, the
+ * blobs of the dives that are not cached are written in parallel before
+ * the tree is built. Since blob ids only depend on the content, the
+ * resulting tree is the same as when writing them one by one.
+ */
+static bool git_parallel_save = true;
+
+void set_git_parallel_save(bool enable)
+{
+	git_parallel_save = enable;
+}
+
+struct dive_blobs {
+	bool written = false;
+	git_oid dive;
+	std::vector<git_oid> dcs;
+};
+
+using dive_blob_map = std::unordered_map<struct dive *, dive_blobs>;
+
+static bool write_dive_blobs(git_repository *repo, struct dive &dive, struct dive_blobs &blobs)
+{
+	membuffer buf;
+
+	create_dive_buffer(dive, &buf);
+	if (git_blob_create_frombuffer(&blobs.dive, repo, buf.buffer, buf.len))
+		return false;
+	blobs.dcs.resize(dive.dcs.size());
+	for (size_t i = 0; i < dive.dcs.size(); i++) {
+		if (write_dc_blob(repo, dive, dive.dcs[i], &blobs.dcs[i]))
+			return false;
+	}
+	return true;
+}
+
+/* libgit2 repositories must not be shared between threads, therefore every worker opens its own */
+static void write_dive_blobs_worker(const char *path, std::vector<dive_blob_map::value_type *> *todo, std::atomic<size_t> *next)
+{
+	git_repository *repo;
+	if (git_repository_open(&repo, path))
+		return;
+	size_t i;
+	while ((i = (*next)++) < todo->size()) {
+		dive_blob_map::value_type &entry = *(*todo)[i];
+		entry.second.written = write_dive_blobs(repo, *entry.first, entry.second);
+	}
+	git_repository_free(repo);
+}
+
+/*
+ * Dives for which this fails (e.g. because a worker couldn't open the
+ * repository) are simply written by save_one_dive() later on.
+ */
+static void write_all_dive_blobs(git_repository *repo, bool select_only, bool cached_ok, dive_blob_map &blobs)
+{
+	for (auto &dive: divelog.dives) {
+		if ((select_only && !dive->selected) || (cached_ok && dive->cache_is_valid()))
+			continue;
+		blobs[dive.get()];
+	}
+
+	std::vector<dive_blob_map::value_type *> todo;
+	todo.reserve(blobs.size());
+	for (auto &entry: blobs)
+		todo.push_back(&entry);
+
+	size_t nr_threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), todo.size());
+	std::atomic<size_t> next = 0;
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < nr_threads; i++)
+		threads.emplace_back(write_dive_blobs_worker, git_repository_path(repo), &todo, &next);
+	for (std::thread &thread: threads)
+		thread.join();
+}
+
+static int insert_dive_blobs(struct dir *tree, const struct dive &dive, struct dive_blobs &blobs)
+{
+	int nr = dive.number;
+
+	if (blob_id_insert(tree, &blobs.dive, "Dive%c%d", nr ? '-' : 0, nr))
+		return report_error("dive save-file tree insert failed");
+
+	/* Same naming as in save_one_dive() */
+	nr = blobs.dcs.size() > 1 ? 1 : 0;
+	for (git_oid &id: blobs.dcs) {
+		if (blob_id_insert(tree, &id, "Divecomputer%c%03u", nr ? '-' : 0, nr))
+			report_error("divecomputer tree insert failed");
+		nr++;
+	}
+	return 0;
+}
+
+static int save_one_dive(git_repository *repo, struct dir *tree, struct dive &dive, struct tm *tm, bool cached_ok, dive_blob_map &blobs)
 {
 	membuffer buf, name;
 	struct dir *subdir;
@@ -672,6 +962,15 @@ static int save_one_dive(git_repository *repo, struct dir *tree, struct dive &di
 	subdir = new_directory(repo, tree, &name);
 	subdir->unique = true;
 
+	auto it = blobs.find(&dive);
+	if (it != blobs.end() && it->second.written) {
+		ret = insert_dive_blobs(subdir, dive, it->second);
+		if (ret)
+			return ret;
+		save_pictures(repo, subdir, dive);
+		return 0;
+	}
+
 	create_dive_buffer(dive, &buf);
 	nr = dive.number;
 	ret = blob_insert(repo, subdir, &buf,
@@ -781,7 +1080,7 @@ static void verify_shared_date(timestamp_t when, struct tm *tm)
 #define MIN_TIMESTAMP (0)
 #define MAX_TIMESTAMP (0x7fffffffffffffff)
 
-static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip *trip, struct tm *tm, bool cached_ok)
+static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip *trip, struct tm *tm, bool cached_ok, dive_blob_map &blobs)
 {
 	struct dir *subdir;
 	membuffer name;
@@ -812,7 +1111,7 @@ static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip *trip
 	/* Save each dive in the directory */
 	for (auto &dive: divelog.dives) {
 		if (dive->divetrip == trip)
-			save_one_dive(repo, subdir, *dive, tm, cached_ok);
+			save_one_dive(repo, subdir, *dive, tm, cached_ok, blobs);
 	}
 
 	return 0;
@@ -857,7 +1156,10 @@ static void save_settings(git_repository *repo, struct dir *tree)
 {
 	membuffer b;
 
-	put_format(&b, "version %d\n", dataformat_version);
+	/* Older versions would misparse the binary samples, so make them warn */
+	put_format(&b, "version %d", git_binary_samples ? git_binary_samples_dataformat_version : dataformat_version);
+	cond_put_format(git_binary_samples, &b, " binarysamples %d", git_binary_samples_version);
+	put_string(&b, "\n");
 	for (auto &dev: divelog.devices)
 		save_one_device(&b, dev);
 	/* save the fingerprint data */
@@ -989,6 +1291,9 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 
 	/* save the dives */
 	git_storage_update_progress(translate("gettextFromC", "Start saving dives"));
+	dive_blob_map blobs;
+	if (git_parallel_save)
+		write_all_dive_blobs(repo, select_only, cached_ok, blobs);
 	for (auto &dive: divelog.dives) {
 		struct tm tm;
 		struct dir *tree;
@@ -1014,11 +1319,11 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 			trip->saved = 1;
 
 			/* Pass that new subdirectory in for save-trip */
-			save_one_trip(repo, tree, trip, &tm, cached_ok);
+			save_one_trip(repo, tree, trip, &tm, cached_ok, blobs);
 			continue;
 		}
 
-		save_one_dive(repo, tree, *dive, &tm, cached_ok);
+		save_one_dive(repo, tree, *dive, &tm, cached_ok, blobs);
 	}
 	git_storage_update_progress(translate("gettextFromC", "Done creating local cache"));
 	return 0;
@@ -1041,6 +1346,29 @@ static git_object *try_to_find_parent(const char *hex_id, git_repository *repo)
 	return (git_object *)commit;
 }
 
+/*
+ * Whether the version line of the settings in a commit announces binary
+ * samples, see git-access.h
+ */
+static bool commit_has_binary_samples(git_repository *repo, git_object *commit)
+{
+	git_tree *tree;
+	const git_tree_entry *entry;
+	git_blob *blob;
+	bool res = false;
+
+	if (git_commit_tree(&tree, (const git_commit *)commit))
+		return false;
+	entry = git_tree_entry_byname(tree, "00-Subsurface");
+	if (entry && !git_blob_lookup(&blob, repo, git_tree_entry_id(entry))) {
+		std::string settings((const char *)git_blob_rawcontent(blob), git_blob_rawsize(blob));
+		res = settings.substr(0, settings.find('\n')).find(" binarysamples ") != std::string::npos;
+		git_blob_free(blob);
+	}
+	git_tree_free(tree);
+	return res;
+}
+
 static int notify_cb(git_checkout_notify_t,
 	const char *path,
 	const git_diff_file *,
@@ -1265,12 +1593,19 @@ int do_git_save(struct git_info *info, bool select_only, bool create_empty)
 
 	if (!create_empty) // so we are actually saving the dives
 		git_storage_update_progress(translate("gettextFromC", "Preparing to save data"));
+	git_binary_samples = prefs.git_binary_samples;
 
 	/*
 	 * Check if we can do the cached writes - we need to
 	 * have the original git commit we loaded in the repo
 	 */
-	cached_ok = try_to_find_parent(saved_git_id.c_str(), info->repo);
+	git_object *parent = try_to_find_parent(saved_git_id.c_str(), info->repo);
+	cached_ok = parent != NULL;
+
+	/* The cached dive trees can only be used if their samples are in the format we write */
+	if (parent && commit_has_binary_samples(info->repo, parent) != git_binary_samples)
+		cached_ok = false;
+	git_object_free(parent);
 
 	/* Start with an empty tree: no subdirectories, no files */
 	if (git_treebuilder_new(&tree.files, info->repo, NULL))
@@ -7,6 +7,7 @@
 #include "core/file.h"
 #include "core/format.h"
 #include "core/membuffer.h"
+#include "core/plotinfocache.h"
 #include "core/subsurface-string.h"
 #include "core/version.h"
 #include <errno.h>
@@ -59,9 +60,9 @@ static void put_pd(struct membuffer *b, const struct plot_info &pi, int idx)
 	put_int(b, entry.depth);
 	put_int(b, entry.ceiling);
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry.ceilings[i]);
+		put_int(b, get_plot_tissue_ceiling(pi, idx, i));
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry.percentages[i]);
+		put_int(b, get_plot_tissue_percentage(pi, idx, i));
 	put_int(b, entry.ndl);
 	put_int(b, entry.tts);
 	put_int(b, entry.rbt);
@@ -207,12 +208,10 @@ static std::string format_st_event(const plot_data &entry, const plot_data &next
 
 static void save_profiles_buffer(struct membuffer *b, bool select_only)
 {
-	struct deco_state *planner_deco_state = NULL;
-
 	for(auto &dive: divelog.dives) {
 		if (select_only && !dive->selected)
 			continue;
-		plot_info pi = create_plot_info_new(dive.get(), &dive->dcs[0], planner_deco_state);
+		plot_info pi = PlotInfoCache::instance()->get(dive.get(), 0);
 		put_headers(b, pi.nr_cylinders);
 
 		for (int i = 0; i < pi.nr; i++)
@@ -223,9 +222,7 @@ static void save_profiles_buffer(struct membuffer *b, bool select_only)
 
 std::string save_subtitles_buffer(struct dive *dive, int offset, int length)
 {
-	struct deco_state *planner_deco_state = NULL;
-
-	plot_info pi = create_plot_info_new(dive, &dive->dcs[0], planner_deco_state);
+	plot_info pi = PlotInfoCache::instance()->get(dive, 0);
 
 	std::string res;
 	res += "[Script Info]\n";
@@ -11,6 +11,9 @@
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include "device.h"
 #include "dive.h"
@@ -212,7 +215,8 @@ static void save_weightsystem_info(struct membuffer *b, const struct dive &dive)
 
 static void show_integer(struct membuffer *b, int value, const char *pre, const char *post)
 {
-	put_format(b, " %s%d%s", pre, value, post);
+	put_string(b, " ");
+	put_int(b, pre, value, post);
 }
 
 static void show_index(struct membuffer *b, int value, const char *pre, const char *post)
@@ -225,7 +229,7 @@ static void save_sample(struct membuffer *b, const struct sample &sample, struct
 {
 	int idx;
 
-	put_format(b, "  <sample time='%u:%02u min'", FRACTION_TUPLE(sample.time.seconds, 60));
+	put_minsec(b, "  <sample time='", sample.time.seconds, " min'");
 	put_milli(b, " depth='", sample.depth.mm, " m'");
 	if (sample.temperature.mkelvin && sample.temperature.mkelvin != old.temperature.mkelvin) {
 		put_temperature(b, sample.temperature, " temp='", " C'");
@@ -254,36 +258,36 @@ static void save_sample(struct membuffer *b, const struct sample &sample, struct
 			}
 			put_pressure(b, p, " pressure='", " bar'");
 			if (sensor != old.sensor[0]) {
-				put_format(b, " sensor='%d'", sensor);
+				put_int(b, " sensor='", sensor, "'");
 				old.sensor[0] = sensor;
 			}
 			continue;
 		}
 
 		/* The new-style format is much simpler: the sensor is always encoded */
-		put_format(b, " pressure%d=", sensor);
+		put_int(b, " pressure", sensor, "=");
 		put_pressure(b, p, "'", " bar'");
 	}
 
 	/* the deco/ndl values are stored whenever they change */
 	if (sample.ndl.seconds != old.ndl.seconds) {
-		put_format(b, " ndl='%u:%02u min'", FRACTION_TUPLE(sample.ndl.seconds, 60));
+		put_minsec(b, " ndl='", sample.ndl.seconds, " min'");
 		old.ndl = sample.ndl;
 	}
 	if (sample.tts.seconds != old.tts.seconds) {
-		put_format(b, " tts='%u:%02u min'", FRACTION_TUPLE(sample.tts.seconds, 60));
+		put_minsec(b, " tts='", sample.tts.seconds, " min'");
 		old.tts = sample.tts;
 	}
 	if (sample.rbt.seconds != old.rbt.seconds) {
-		put_format(b, " rbt='%u:%02u min'", FRACTION_TUPLE(sample.rbt.seconds, 60));
+		put_minsec(b, " rbt='", sample.rbt.seconds, " min'");
 		old.rbt = sample.rbt;
 	}
 	if (sample.in_deco != old.in_deco) {
-		put_format(b, " in_deco='%d'", sample.in_deco ? 1 : 0);
+		put_int(b, " in_deco='", sample.in_deco ? 1 : 0, "'");
 		old.in_deco = sample.in_deco;
 	}
 	if (sample.stoptime.seconds != old.stoptime.seconds) {
-		put_format(b, " stoptime='%u:%02u min'", FRACTION_TUPLE(sample.stoptime.seconds, 60));
+		put_minsec(b, " stoptime='", sample.stoptime.seconds, " min'");
 		old.stoptime = sample.stoptime;
 	}
 
@@ -293,7 +297,7 @@ static void save_sample(struct membuffer *b, const struct sample &sample, struct
 	}
 
 	if (sample.cns != old.cns) {
-		put_format(b, " cns='%u%%'", sample.cns);
+		put_uint(b, " cns='", sample.cns, "%'");
 		old.cns = sample.cns;
 	}
 
@@ -339,7 +343,7 @@ static void save_sample(struct membuffer *b, const struct sample &sample, struct
 		show_index(b, sample.bearing.degrees, "bearing='", "'");
 		old.bearing.degrees = sample.bearing.degrees;
 	}
-	put_format(b, " />\n");
+	put_string(b, " />\n");
 }
 
 static void save_one_event(struct membuffer *b, const struct dive &dive, const struct event &ev)
@@ -543,7 +547,61 @@ int save_dive(FILE *f, const struct dive &dive, bool anonymize)
 	return 0;
 }
 
-static void save_trip(struct membuffer *b, dive_trip &trip, bool anonymize)
+static bool xml_parallel_save = true;
+
+void set_xml_parallel_save(bool enable)
+{
+	xml_parallel_save = enable;
+}
+
+static void render_dives_worker(const std::vector<const struct dive *> *todo, std::vector<membuffer> *res, bool anonymize, std::atomic<size_t> *next)
+{
+	size_t i;
+	while ((i = (*next)++) < todo->size()) {
+		if ((*todo)[i])
+			save_one_dive_to_mb(&(*res)[i], *(*todo)[i], anonymize);
+	}
+}
+
+/*
+ * Render the dives that are to be saved into one membuffer each, indexed
+ * like the global dive table. Writing a dive only reads from it, so this
+ * is done in parallel and save_dives_buffer() merely has to concatenate
+ * the fragments in the right order.
+ */
+static std::vector<membuffer> render_dives(bool select_only, bool anonymize)
+{
+	std::vector<const struct dive *> todo;
+	todo.reserve(divelog.dives.size());
+	for (auto &dive: divelog.dives)
+		todo.push_back(!select_only || dive->selected ? dive.get() : nullptr);
+
+	std::vector<membuffer> res(todo.size());
+	size_t nr_threads = xml_parallel_save ?
+		std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), todo.size()) : 1;
+	std::atomic<size_t> next = 0;
+	if (nr_threads <= 1) {
+		render_dives_worker(&todo, &res, anonymize, &next);
+		return res;
+	}
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < nr_threads; i++)
+		threads.emplace_back(render_dives_worker, &todo, &res, anonymize, &next);
+	for (std::thread &thread: threads)
+		thread.join();
+	return res;
+}
+
+/* Append a dive rendered by render_dives() and release its memory */
+static void put_rendered_dive(struct membuffer *b, membuffer &rendered)
+{
+	put_bytes(b, rendered.buffer, rendered.len);
+	free(rendered.buffer);
+	rendered.buffer = nullptr;
+	rendered.len = rendered.alloc = 0;
+}
+
+static void save_trip(struct membuffer *b, dive_trip &trip, std::vector<membuffer> &rendered)
 {
 	put_format(b, "<trip");
 	show_date(b, trip.date());
@@ -557,9 +615,9 @@ static void save_trip(struct membuffer *b, dive_trip &trip, bool anonymize)
 	 * list in the trip, we just traverse the global dive array and
 	 * check the divetrip pointer..
 	 */
-	for (auto &dive: divelog.dives) {
-		if (dive->divetrip == &trip)
-			save_one_dive_to_mb(b, *dive, anonymize);
+	for (size_t i = 0; i < divelog.dives.size(); i++) {
+		if (divelog.dives[i]->divetrip == &trip)
+			put_rendered_dive(b, rendered[i]);
 	}
 
 	put_format(b, "</trip>\n");
@@ -682,17 +740,19 @@ static void save_dives_buffer(struct membuffer *b, bool select_only, bool anonym
 	save_filter_presets(b);
 
 	/* save the dives */
-	for (auto &dive: divelog.dives) {
+	std::vector<membuffer> rendered = render_dives(select_only, anonymize);
+	for (size_t i = 0; i < divelog.dives.size(); i++) {
+		const std::unique_ptr<dive> &dive = divelog.dives[i];
 		if (select_only) {
 			if (!dive->selected)
 				continue;
-			save_one_dive_to_mb(b, *dive, anonymize);
+			put_rendered_dive(b, rendered[i]);
 		} else {
 			dive_trip *trip = dive->divetrip;
 
 			/* Bare dive without a trip? */
 			if (!trip) {
-				save_one_dive_to_mb(b, *dive, anonymize);
+				put_rendered_dive(b, rendered[i]);
 				continue;
 			}
 
@@ -702,7 +762,7 @@ static void save_dives_buffer(struct membuffer *b, bool select_only, bool anonym
 
 			/* We haven't seen this trip before - save it and all dives */
 			trip->saved = 1;
-			save_trip(b, *trip, anonymize);
+			save_trip(b, *trip, rendered);
 		}
 	}
 	put_format(b, "</dives>\n</divelog>\n");
@@ -29,6 +29,10 @@ void qPrefDivePlanner::loadSync(bool doSync)
 	disk_display_runtime(doSync);
 	disk_display_transitions(doSync);
 	disk_display_variations(doSync);
+	disk_variations_depth_steps(doSync);
+	disk_variations_time_steps(doSync);
+	disk_variations_gf_steps(doSync);
+	disk_variations_table(doSync);
 	disk_doo2breaks(doSync);
 	disk_dobailout(doSync);
 	disk_o2narcotic(doSync);
@@ -71,6 +75,14 @@ HANDLE_PREFERENCE_BOOL(DivePlanner, "display_runtime", display_runtime);
 HANDLE_PREFERENCE_BOOL(DivePlanner, "display_transitions", display_transitions);
 HANDLE_PREFERENCE_BOOL(DivePlanner, "display_variations", display_variations);
 
+HANDLE_PREFERENCE_INT(DivePlanner, "variations_depth_steps", variations_depth_steps);
+
+HANDLE_PREFERENCE_INT(DivePlanner, "variations_time_steps", variations_time_steps);
+
+HANDLE_PREFERENCE_INT(DivePlanner, "variations_gf_steps", variations_gf_steps);
+
+HANDLE_PREFERENCE_BOOL(DivePlanner, "variations_table", variations_table);
+
 HANDLE_PREFERENCE_BOOL(DivePlanner, "doo2breaks", doo2breaks);
 HANDLE_PREFERENCE_BOOL(DivePlanner, "dobailbout", dobailout);
 HANDLE_PREFERENCE_BOOL(DivePlanner, "o2narcotic", o2narcotic);
@@ -21,6 +21,10 @@ class qPrefDivePlanner : public QObject {
 	Q_PROPERTY(bool display_runtime READ display_runtime WRITE set_display_runtime NOTIFY display_runtimeChanged)
 	Q_PROPERTY(bool display_transitions READ display_transitions WRITE set_display_transitions NOTIFY      display_transitionsChanged)
 	Q_PROPERTY(bool display_variations READ display_variations WRITE set_display_variations NOTIFY display_variationsChanged)
+	Q_PROPERTY(int variations_depth_steps READ variations_depth_steps WRITE set_variations_depth_steps NOTIFY variations_depth_stepsChanged)
+	Q_PROPERTY(int variations_time_steps READ variations_time_steps WRITE set_variations_time_steps NOTIFY variations_time_stepsChanged)
+	Q_PROPERTY(int variations_gf_steps READ variations_gf_steps WRITE set_variations_gf_steps NOTIFY variations_gf_stepsChanged)
+	Q_PROPERTY(bool variations_table READ variations_table WRITE set_variations_table NOTIFY variations_tableChanged)
 	Q_PROPERTY(bool doo2breaks READ doo2breaks WRITE set_doo2breaks NOTIFY doo2breaksChanged)
 	Q_PROPERTY(bool dobailout READ dobailout WRITE set_dobailout NOTIFY dobailoutChanged)
 	Q_PROPERTY(bool o2narcotic READ o2narcotic WRITE set_o2narcotic NOTIFY o2narcoticChanged)
@@ -58,6 +62,10 @@ public:
 	static bool display_runtime() { return prefs.display_runtime; }
 	static bool display_transitions() { return prefs.display_transitions; }
 	static bool display_variations() { return prefs.display_variations; }
+	static int variations_depth_steps() { return prefs.variations_depth_steps; }
+	static int variations_time_steps() { return prefs.variations_time_steps; }
+	static int variations_gf_steps() { return prefs.variations_gf_steps; }
+	static bool variations_table() { return prefs.variations_table; }
 	static bool doo2breaks() { return prefs.doo2breaks; }
 	static bool dobailout() { return prefs.dobailout; }
 	static bool o2narcotic() { return prefs.o2narcotic; }
@@ -88,6 +96,10 @@ public slots:
 	static void set_display_runtime(bool value);
 	static void set_display_transitions(bool value);
 	static void set_display_variations(bool value);
+	static void set_variations_depth_steps(int value);
+	static void set_variations_time_steps(int value);
+	static void set_variations_gf_steps(int value);
+	static void set_variations_table(bool value);
 	static void set_doo2breaks(bool value);
 	static void set_dobailout(bool value);
 	static void set_o2narcotic(bool value);
@@ -118,6 +130,10 @@ signals:
 	void display_runtimeChanged(bool value);
 	void display_transitionsChanged(bool value);
 	void display_variationsChanged(bool value);
+	void variations_depth_stepsChanged(int value);
+	void variations_time_stepsChanged(int value);
+	void variations_gf_stepsChanged(int value);
+	void variations_tableChanged(bool value);
 	void doo2breaksChanged(bool value);
 	void dobailoutChanged(bool value);
 	void o2narcoticChanged(bool value);
@@ -151,6 +167,10 @@ private:
 	static void disk_display_runtime(bool doSync);
 	static void disk_display_transitions(bool doSync);
 	static void disk_display_variations(bool doSync);
+	static void disk_variations_depth_steps(bool doSync);
+	static void disk_variations_time_steps(bool doSync);
+	static void disk_variations_gf_steps(bool doSync);
+	static void disk_variations_table(bool doSync);
 	static void disk_doo2breaks(bool doSync);
 	static void disk_dobailout(bool doSync);
 	static void disk_o2narcotic(bool doSync);
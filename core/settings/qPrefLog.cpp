@@ -18,6 +18,7 @@ void qPrefLog::loadSync(bool doSync)
 	disk_extraEnvironmentalDefault(doSync);
 	disk_salinityEditDefault(doSync);
 	disk_show_average_depth(doSync);
+	disk_git_binary_samples(doSync);
 }
 
 void qPrefLog::set_default_file_behavior(enum def_file_behavior value)
@@ -58,3 +59,5 @@ HANDLE_PREFERENCE_BOOL(Log, "use_default_file", use_default_file);
 HANDLE_PREFERENCE_BOOL(Log, "salinityEditDefault", salinityEditDefault);
 
 HANDLE_PREFERENCE_BOOL(Log, "show_average_depth", show_average_depth);
+
+HANDLE_PREFERENCE_BOOL(Log, "git_binary_samples", git_binary_samples);
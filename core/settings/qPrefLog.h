@@ -13,6 +13,7 @@ class qPrefLog : public QObject {
 	Q_PROPERTY(bool extraEnvironmentalDefault READ extraEnvironmentalDefault WRITE set_extraEnvironmentalDefault NOTIFY extraEnvironmentalDefaultChanged);
 	Q_PROPERTY(bool salinityEditDefault READ salinityEditDefault WRITE set_salinityEditDefault NOTIFY salinityEditDefaultChanged);
 	Q_PROPERTY(bool show_average_depth READ show_average_depth WRITE set_show_average_depth NOTIFY show_average_depthChanged)
+	Q_PROPERTY(bool git_binary_samples READ git_binary_samples WRITE set_git_binary_samples NOTIFY git_binary_samplesChanged)
 
 public:
 	static qPrefLog *instance();
@@ -29,6 +30,7 @@ public:
 	static bool extraEnvironmentalDefault() { return prefs.extraEnvironmentalDefault; }
 	static bool salinityEditDefault() { return prefs.salinityEditDefault; }
 	static bool show_average_depth() { return prefs.show_average_depth; }
+	static bool git_binary_samples() { return prefs.git_binary_samples; }
 
 public slots:
 	static void set_default_filename(const QString& value);
@@ -37,6 +39,7 @@ public slots:
 	static void set_extraEnvironmentalDefault(bool value);
 	static void set_salinityEditDefault(bool value);
 	static void set_show_average_depth(bool value);
+	static void set_git_binary_samples(bool value);
 
 signals:
 	void default_filenameChanged(const QString& value);
@@ -45,6 +48,7 @@ signals:
 	void extraEnvironmentalDefaultChanged(bool value);
 	void salinityEditDefaultChanged(bool value);
 	void show_average_depthChanged(bool value);
+	void git_binary_samplesChanged(bool value);
 
 private:
 	qPrefLog() {}
@@ -55,6 +59,7 @@ private:
 	static void disk_extraEnvironmentalDefault(bool doSync);
 	static void disk_salinityEditDefault(bool doSync);
 	static void disk_show_average_depth(bool doSync);
+	static void disk_git_binary_samples(bool doSync);
 
 };
 
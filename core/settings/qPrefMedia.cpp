@@ -17,9 +17,11 @@ void qPrefMedia::loadSync(bool doSync)
 	disk_ffmpeg_executable(doSync);
 	disk_auto_recalculate_thumbnails(doSync);
 	disk_auto_recalculate_thumbnails(doSync);
+	disk_thumbnail_threads(doSync);
 }
 
 HANDLE_PREFERENCE_BOOL(Media, "auto_recalculate_thumbnails", auto_recalculate_thumbnails);
+HANDLE_PREFERENCE_INT(Media, "thumbnail_threads", thumbnail_threads);
 HANDLE_PREFERENCE_BOOL(Media, "extract_video_thumbnails", extract_video_thumbnails);
 HANDLE_PREFERENCE_INT(Media, "extract_video_thumbnails_position", extract_video_thumbnails_position);
 HANDLE_PREFERENCE_TXT(Media, "ffmpeg_executable", ffmpeg_executable);
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0
+// Non-cryptographic hashing (FNV-1a) of plain values. Used to detect
+// whether the input of a cached calculation has changed.
+#ifndef SUBSURFACE_HASH_H
+#define SUBSURFACE_HASH_H
+
+#include <stdint.h>
+#include <string.h>
+
+static constexpr uint64_t hash_seed = 0xcbf29ce484222325ULL;
+
+static inline uint64_t hash_value(uint64_t hash, uint64_t v)
+{
+	/* FNV-1a, byte by byte */
+	for (int i = 0; i < 8; i++) {
+		hash ^= (v >> (i * 8)) & 0xff;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static inline uint64_t hash_value(uint64_t hash, double v)
+{
+	uint64_t bits;
+	memcpy(&bits, &v, sizeof(bits));
+	return hash_value(hash, bits);
+}
+
+static inline uint64_t hash_value(uint64_t hash, int v)
+{
+	return hash_value(hash, static_cast<uint64_t>(v));
+}
+
+#endif // SUBSURFACE_HASH_H
@@ -0,0 +1,324 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "thumbnailstore.h"
+#include "errorhelper.h"
+#include "qthelper.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+// The data file is a sequence of records. Each record consists of a header
+// and the data. All numbers are little endian:
+//	uint32	magic
+//	uint32	size of the data
+//	int64	time of writing in msec since the epoch
+//	char	key[20]
+//	char	data[size]
+// Replaced records are left in place, until the file is compacted.
+//
+// The index file is a QDataStream of:
+//	uint32	version
+//	int64	size of the data file when the index was written
+//	uint32	number of entries
+//	for each entry:
+//		char	key[20]
+//		int64	offset of the data
+//		uint32	size of the data
+//		int64	time of writing
+// Records that were appended after writing the index are found by scanning
+// the data file from the stored size onward.
+static const quint32 recordMagic = 0x424d4854;	// "THMB"
+static const int keySize = 20;			// SHA1
+static const int headerSize = 16 + keySize;
+static const quint32 indexVersion = 1;
+static const qint64 compactThreshold = 1024 * 1024;
+// Records that were appended after mapping the data file are read by copying
+// until the unmapped part reaches this size. Then only that part is mapped,
+// so that every byte of the file is mapped at most once. Old maps are kept,
+// since there may be references to them.
+static const qint64 remapThreshold = 4 * 1024 * 1024;
+// Waiting for another instance, which may be compacting the data file.
+static const int lockTimeout = 10000;	// msec
+
+ThumbnailStore *ThumbnailStore::instance()
+{
+	static ThumbnailStore self(thumbnailDir());
+	return &self;
+}
+
+ThumbnailStore::ThumbnailStore(const QString &dir) :
+	indexFilename(QDir(dir).filePath("thumbnails.idx")),
+	data(QDir(dir).filePath("thumbnails.dat")),
+	fileLock(QDir(dir).filePath("thumbnails.lock")),
+	indexedSize(0),
+	mappedSize(0)
+{
+	QDir().mkpath(dir);
+	if (!data.open(QIODevice::ReadWrite)) {
+		report_info("Cannot open thumbnail store %s", qPrintable(data.fileName()));
+		return;
+	}
+
+	// Without the lock, another instance may be writing a record or compacting.
+	// Then the store is used as is, without dropping garbage or compacting.
+	bool locked = fileLock.tryLock(lockTimeout);
+	if (!locked)
+		report_info("Cannot lock thumbnail store %s", qPrintable(data.fileName()));
+	if (!readIndex()) {
+		index.clear();
+		indexedSize = 0;
+	}
+	scan(indexedSize, locked);
+	bool compacted = locked && data.size() > compactThreshold && usedSize() * 2 < data.size() && compact();
+	if (locked)
+		fileLock.unlock();
+	if (compacted)
+		writeIndex();
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+	if (data.isOpen())
+		writeIndex();
+}
+
+// Map the part of the data file that was appended since the last call.
+void ThumbnailStore::map()
+{
+	qint64 size = data.size();
+	if (size <= mappedSize)
+		return;
+	uchar *p = data.map(mappedSize, size - mappedSize);
+	if (!p)
+		return;
+	maps.push_back({ mappedSize, size - mappedSize, p });
+	mappedSize = size;
+}
+
+void ThumbnailStore::unmapAll()
+{
+	for (const Map &m: maps)
+		data.unmap(m.p);
+	maps.clear();
+	mappedSize = 0;
+}
+
+// Returns a pointer to the given range of the data file, or null if
+// the range is not contained in a single map.
+const uchar *ThumbnailStore::mapped(qint64 offset, qint64 size) const
+{
+	auto it = std::upper_bound(maps.begin(), maps.end(), offset,
+				   [](qint64 offset, const Map &m) { return offset < m.offset; });
+	if (it == maps.begin())
+		return nullptr;
+	--it;
+	if (offset + size > it->offset + it->size)
+		return nullptr;
+	return it->p + (offset - it->offset);
+}
+
+bool ThumbnailStore::readIndex()
+{
+	QFile f(indexFilename);
+	if (!f.open(QIODevice::ReadOnly))
+		return false;
+	QDataStream stream(&f);
+	quint32 version, count;
+	qint64 size;
+	stream >> version >> size >> count;
+	if (stream.status() != QDataStream::Ok || version != indexVersion || size > data.size())
+		return false;
+
+	// The entries must point to the headers of records with the same key and size.
+	// Otherwise, the data file was replaced or rewritten behind our back.
+	map();
+	const uchar *p = mapped(0, size);
+	index.reserve(count);
+	for (quint32 i = 0; i < count; ++i) {
+		QByteArray key(keySize, 0);
+		Entry e;
+		if (stream.readRawData(key.data(), keySize) != keySize)
+			return false;
+		stream >> e.offset >> e.size >> e.mtime;
+		if (stream.status() != QDataStream::Ok || e.offset < headerSize || e.offset + e.size > size || !p)
+			return false;
+		const uchar *header = p + e.offset - headerSize;
+		if (qFromLittleEndian<quint32>(header) != recordMagic ||
+		    qFromLittleEndian<quint32>(header + 4) != e.size ||
+		    memcmp(header + 16, key.constData(), keySize) != 0)
+			return false;
+		index.insert(key, e);
+	}
+	indexedSize = size;
+	return true;
+}
+
+// Add the records starting at the given offset to the index.
+// If trim is true, a partially written record at the end is dropped,
+// which must only be done while holding the lock file.
+void ThumbnailStore::scan(qint64 from, bool trim)
+{
+	qint64 size = data.size();
+	map();
+	const uchar *p = mapped(0, size);
+	if (!p)
+		return;
+	qint64 pos = from;
+	while (pos + headerSize <= size) {
+		const uchar *header = p + pos;
+		if (qFromLittleEndian<quint32>(header) != recordMagic)
+			break;
+		quint32 dataSize = qFromLittleEndian<quint32>(header + 4);
+		if (pos + headerSize + dataSize > size)
+			break;
+		qint64 mtime = qFromLittleEndian<qint64>(header + 8);
+		QByteArray key(reinterpret_cast<const char *>(header + 16), keySize);
+		index.insert(key, { pos + headerSize, dataSize, mtime });
+		pos += headerSize + dataSize;
+	}
+
+	// Drop a partially written record, e.g. after a crash. Called before
+	// handing out any data, so the maps can be dropped with the garbage.
+	if (trim && pos < size) {
+		report_info("Dropping %lld bytes of garbage at the end of the thumbnail store", size - pos);
+		unmapAll();
+		data.resize(pos);
+	}
+}
+
+// Rewrite the data file with only the records in the index.
+// Must only be called when no references into the maps exist
+// and while holding the lock file. Returns true if the file was replaced,
+// in which case the index has to be written.
+bool ThumbnailStore::compact()
+{
+	map();
+	const uchar *p = mapped(0, data.size());
+	if (!p)
+		return false;
+	std::vector<std::pair<QByteArray, Entry>> entries;
+	entries.reserve(index.size());
+	for (auto it = index.begin(); it != index.end(); ++it)
+		entries.emplace_back(it.key(), it.value());
+	std::sort(entries.begin(), entries.end(),
+		  [](const auto &e1, const auto &e2) { return e1.second.offset < e2.second.offset; });
+
+	QSaveFile out(data.fileName());
+	if (!out.open(QIODevice::WriteOnly))
+		return false;
+	qint64 pos = 0;
+	for (auto &[key, e]: entries) {
+		qint64 recordSize = headerSize + e.size;
+		if (out.write(reinterpret_cast<const char *>(p + e.offset - headerSize), recordSize) != recordSize)
+			return false;
+		e.offset = pos + headerSize;
+		pos += recordSize;
+	}
+
+	// Unmap the old file before replacing it.
+	unmapAll();
+	data.close();
+	bool ok = out.commit();
+	if (!data.open(QIODevice::ReadWrite))
+		report_info("Cannot reopen thumbnail store %s", qPrintable(data.fileName()));
+	if (!ok)
+		return false;
+	for (const auto &[key, e]: entries)
+		index[key] = e;
+	return true;
+}
+
+QByteArray ThumbnailStore::get(const QByteArray &key, qint64 *mtime)
+{
+	QMutexLocker l(&lock);
+	auto it = index.constFind(key);
+	if (it == index.cend())
+		return QByteArray();
+	if (mtime)
+		*mtime = it->mtime;
+
+	qint64 end = it->offset + it->size;
+	if (end > mappedSize && data.size() - mappedSize >= remapThreshold)
+		map();
+	if (const uchar *p = mapped(it->offset, it->size))
+		return QByteArray::fromRawData(reinterpret_cast<const char *>(p), it->size);
+
+	// Recently appended record or a record that spans two maps: read a copy.
+	if (!data.seek(it->offset))
+		return QByteArray();
+	return data.read(it->size);
+}
+
+bool ThumbnailStore::put(const QByteArray &key, const QByteArray &bytes)
+{
+	if (key.size() != keySize)
+		return false;
+	qint64 mtime = QDateTime::currentMSecsSinceEpoch();
+	uchar header[headerSize];
+	qToLittleEndian<quint32>(recordMagic, header);
+	qToLittleEndian<quint32>(static_cast<quint32>(bytes.size()), header + 4);
+	qToLittleEndian<qint64>(mtime, header + 8);
+	std::copy(key.begin(), key.end(), header + 16);
+
+	QMutexLocker l(&lock);
+	if (!data.isOpen() || !fileLock.tryLock(lockTimeout))
+		return false;
+	// Another instance may have appended records. Write after those.
+	qint64 pos = data.size();
+	if (!data.seek(pos) ||
+	    data.write(reinterpret_cast<const char *>(header), headerSize) != headerSize ||
+	    data.write(bytes) != bytes.size() ||
+	    !data.flush()) {
+		data.resize(pos);
+		fileLock.unlock();
+		return false;
+	}
+	fileLock.unlock();
+	index.insert(key, { pos + headerSize, static_cast<quint32>(bytes.size()), mtime });
+	return true;
+}
+
+void ThumbnailStore::writeIndex()
+{
+	QMutexLocker l(&lock);
+	if (!data.isOpen() || !fileLock.tryLock(lockTimeout))
+		return;
+	qint64 size = data.size();
+	QSaveFile f(indexFilename);
+	if (f.open(QIODevice::WriteOnly)) {
+		QDataStream stream(&f);
+		stream << indexVersion << size << static_cast<quint32>(index.size());
+		for (auto it = index.cbegin(); it != index.cend(); ++it) {
+			stream.writeRawData(it.key().constData(), keySize);
+			stream << it->offset << it->size << it->mtime;
+		}
+		if (stream.status() == QDataStream::Ok && f.commit())
+			indexedSize = size;
+	}
+	fileLock.unlock();
+}
+
+qint64 ThumbnailStore::dataSize() const
+{
+	QMutexLocker l(&lock);
+	return data.size();
+}
+
+qint64 ThumbnailStore::usedSize() const
+{
+	QMutexLocker l(&lock);
+	qint64 res = 0;
+	for (const Entry &e: index)
+		res += headerSize + e.size;
+	return res;
+}
+
+int ThumbnailStore::count() const
+{
+	QMutexLocker l(&lock);
+	return index.size();
+}
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-2.0
+// All thumbnails in one append-only data file, which is memory mapped for
+// reading, plus an index from the hash of the picture filename to the data.
+// The store may be shared by several instances of the application: writing
+// to the data file is serialized by a lock file.
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QLockFile>
+#include <QMutex>
+#include <QString>
+#include <vector>
+
+class ThumbnailStore {
+public:
+	// The store of the thumbnail directory
+	static ThumbnailStore *instance();
+
+	// Opens or creates the store in the given directory.
+	// If more than half of the data file is unused, it is compacted.
+	ThumbnailStore(const QString &dir);
+	~ThumbnailStore();
+
+	// Returns the data stored for the given key, or a null byte array.
+	// The data is not copied: it points into the memory map of the
+	// data file, which is valid for the lifetime of the store.
+	// If mtime is non-null, it is set to the time the data was stored
+	// in milliseconds since the epoch.
+	QByteArray get(const QByteArray &key, qint64 *mtime = nullptr);
+
+	// Appends the data. Replaces earlier data with the same key.
+	bool put(const QByteArray &key, const QByteArray &data);
+
+	// Writes the index, so that the data file doesn't have to be scanned
+	// on the next start. Called when closing the application.
+	void writeIndex();
+
+	qint64 dataSize() const;	// Size of the data file
+	qint64 usedSize() const;	// Size of the records that are referenced by the index
+	int count() const;
+private:
+	struct Entry {
+		qint64 offset;	// Offset of the data, not of the record header
+		quint32 size;
+		qint64 mtime;
+	};
+
+	// A mapped part of the data file
+	struct Map {
+		qint64 offset;
+		qint64 size;
+		uchar *p;
+	};
+
+	bool readIndex();
+	void scan(qint64 from, bool trim);
+	bool compact();
+	void map();
+	void unmapAll();
+	const uchar *mapped(qint64 offset, qint64 size) const;
+
+	mutable QMutex lock;
+	QString indexFilename;
+	QFile data;
+	QLockFile fileLock;		// Held while writing to the data file or the index
+	qint64 indexedSize;		// Size of the data file when the index was written
+	std::vector<Map> maps;		// Consecutive parts of the data file. Only unmapped
+					// when no pointers were handed out by get()
+	qint64 mappedSize;		// End of the last map
+	QHash<QByteArray, Entry> index;
+};
+
+#endif
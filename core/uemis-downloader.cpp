@@ -1090,6 +1090,8 @@ static void get_uemis_divespot(device_data_t *devdata, const std::string &mountp
 		ds->add_dive(dive);
 	} else if (nds && !nds->name.empty() && nds->name.find("from Uemis") != std::string::npos) {
 		if (load_uemis_divespot(mountpath, divespot_id)) {
+			/* set_divelocation() moved the site behind the table's back */
+			devdata->log->sites.location_changed(nds);
 			/* get the divesite based on the diveid, this should give us
 			* the newly created site
 			*/
@@ -29,6 +29,7 @@
 #include "desktop-widgets/simplewidgets.h"
 #include "desktop-widgets/mapwidget.h"
 #include "desktop-widgets/tripselectiondialog.h"
+#include "profile-widget/plotinfoloader.h"
 
 DiveListView::DiveListView(QWidget *parent) : QTreeView(parent),
 	currentLayout(DiveTripModelBase::TREE),
@@ -428,6 +429,24 @@ void DiveListView::currentChanged(const QModelIndex &current, const QModelIndex&
 	if (!current.isValid())
 		return;
 	scrollTo(current);
+	prefetchProfiles(current);
+}
+
+// Calculate the profiles of the dives above and below the current dive in
+// the background, so that they can be shown immediately when stepping through
+// the list.
+void DiveListView::prefetchProfiles(const QModelIndex &current)
+{
+	const struct dive *d = current.data(DiveTripModelBase::DIVE_ROLE).value<struct dive *>();
+	if (!d)
+		return;
+	std::vector<const struct dive *> neighbours;
+	for (QModelIndex idx: { indexAbove(current), indexBelow(current) }) {
+		const struct dive *neighbour = idx.data(DiveTripModelBase::DIVE_ROLE).value<struct dive *>();
+		if (neighbour)
+			neighbours.push_back(neighbour);
+	}
+	PlotInfoLoader::instance()->prefetch(d, neighbours);
 }
 
 void DiveListView::selectDiveSitesOnMap(const std::vector<dive *> &dives)
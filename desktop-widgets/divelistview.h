@@ -82,6 +82,7 @@ private:
 	void mouseDoubleClickEvent(QMouseEvent *event) override;
 	void contextMenuEvent(QContextMenuEvent *event) override;
 	void currentChanged(const QModelIndex &current, const QModelIndex &previous) override;
+	void prefetchProfiles(const QModelIndex &current);
 	QNetworkAccessManager manager;
 	bool programmaticalSelectionChange;
 };
@@ -2,6 +2,7 @@
 #include "desktop-widgets/divepicturewidget.h"
 #include "core/metrics.h"
 #include "core/qthelper.h"
+#include "qt-models/divepicturemodel.h"
 #include <QDrag>
 #include <QMimeData>
 #include <QMouseEvent>
@@ -61,3 +62,71 @@ void DivePictureWidget::wheelEvent(QWheelEvent *event)
 	} else
 		QListView::wheelEvent(event);
 }
+
+// The visible thumbnails are not updated while the widget is hidden.
+void DivePictureWidget::showEvent(QShowEvent *event)
+{
+	QListView::showEvent(event);
+	updateVisibleThumbnails();
+}
+
+void DivePictureWidget::scrollContentsBy(int dx, int dy)
+{
+	QListView::scrollContentsBy(dx, dy);
+	updateVisibleThumbnails();
+}
+
+// Called after the items were laid out, i.e. on resize, zoom and model changes.
+void DivePictureWidget::updateGeometries()
+{
+	QListView::updateGeometries();
+	updateVisibleThumbnails();
+}
+
+// Binary search for the first row for which pred is false,
+// given that it is true for all rows before and false for all rows after.
+template <typename Pred>
+static int partitionPoint(int rows, Pred pred)
+{
+	int lo = 0, hi = rows;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (pred(mid))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// Tell the model which pictures are shown, so that their thumbnails are calculated first.
+void DivePictureWidget::updateVisibleThumbnails()
+{
+	DivePictureModel *m = qobject_cast<DivePictureModel *>(model());
+	if (!m || !isVisible())
+		return;
+	int rows = m->rowCount();
+	QRect rect = viewport()->rect();
+	QModelIndex topLeft = indexAt(rect.topLeft());
+	QModelIndex bottomRight = indexAt(rect.bottomRight());
+
+	// The corners may fall into the spacing between the thumbnails or behind
+	// the last one. Since the thumbnails flow left to right, top to bottom,
+	// then search for the first thumbnail that ends below the top of the
+	// viewport and the last one that starts above its bottom.
+	auto rowRect = [this, m](int row) { return visualRect(m->index(row, 0)); };
+	int from = topLeft.isValid() ? topLeft.row() :
+		   partitionPoint(rows, [&](int row) { return rowRect(row).bottom() < rect.top(); });
+	int to = bottomRight.isValid() ? bottomRight.row() :
+		 partitionPoint(rows, [&](int row) { return rowRect(row).top() <= rect.bottom(); }) - 1;
+
+	int first = -1, last = -1;
+	for (int i = from; i <= to && i < rows; ++i) {
+		if (rowRect(i).intersects(rect)) {
+			if (first < 0)
+				first = i;
+			last = i;
+		}
+	}
+	m->setVisibleRows(first, last);
+}
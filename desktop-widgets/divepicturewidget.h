@@ -12,10 +12,15 @@ protected:
 	void mouseDoubleClickEvent(QMouseEvent *event) override;
 	void mousePressEvent(QMouseEvent *event) override;
 	void wheelEvent(QWheelEvent *event) override;
+	void showEvent(QShowEvent *event) override;
+	void scrollContentsBy(int dx, int dy) override;
+	void updateGeometries() override;
 
 signals:
 	void photoDoubleClicked(const QString filePath);
 	void zoomLevelChanged(int delta);
+private:
+	void updateVisibleThumbnails();
 };
 
 #endif
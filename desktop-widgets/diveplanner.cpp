@@ -269,6 +269,7 @@ void PlannerSettingsWidget::disableDecoElements(int mode, divemode_t divemode)
 		ui.sacfactor->blockSignals(false);
 		ui.problemsolvingtime->blockSignals(false);
 		ui.display_variations->setDisabled(true);
+		ui.variationsGrid->setDisabled(true);
 	} else if (mode == VPMB) {
 		ui.label_gflow->setDisabled(true);
 		ui.label_gfhigh->setDisabled(true);
@@ -303,6 +304,7 @@ void PlannerSettingsWidget::disableDecoElements(int mode, divemode_t divemode)
 		ui.sacfactor->setValue(PlannerShared::sacfactor());
 		ui.problemsolvingtime->setValue(prefs.problemsolvingtime);
 		ui.display_variations->setDisabled(false);
+		ui.variationsGrid->setEnabled(prefs.display_variations);
 	} else if (mode == BUEHLMANN) {
 		ui.label_gflow->setDisabled(false);
 		ui.label_gfhigh->setDisabled(false);
@@ -337,6 +339,7 @@ void PlannerSettingsWidget::disableDecoElements(int mode, divemode_t divemode)
 		ui.sacfactor->setValue(PlannerShared::sacfactor());
 		ui.problemsolvingtime->setValue(prefs.problemsolvingtime);
 		ui.display_variations->setDisabled(false);
+		ui.variationsGrid->setEnabled(prefs.display_variations);
 	}
 }
 
@@ -373,6 +376,10 @@ PlannerSettingsWidget::PlannerSettingsWidget(PlannerWidgets *parent)
 	ui.display_runtime->setChecked(prefs.display_runtime);
 	ui.display_transitions->setChecked(prefs.display_transitions);
 	ui.display_variations->setChecked(prefs.display_variations);
+	ui.variations_depth_steps->setValue(prefs.variations_depth_steps);
+	ui.variations_time_steps->setValue(prefs.variations_time_steps);
+	ui.variations_gf_steps->setValue(prefs.variations_gf_steps);
+	ui.variations_table->setChecked(prefs.variations_table);
 	ui.safetystop->setChecked(prefs.safetystop);
 	ui.sacfactor->setValue(PlannerShared::sacfactor());
 	ui.problemsolvingtime->setValue(prefs.problemsolvingtime);
@@ -401,6 +408,11 @@ PlannerSettingsWidget::PlannerSettingsWidget(PlannerWidgets *parent)
 	connect(ui.display_runtime, &QAbstractButton::toggled, plannerModel, &DivePlannerPointsModel::setDisplayRuntime);
 	connect(ui.display_transitions, &QAbstractButton::toggled, plannerModel, &DivePlannerPointsModel::setDisplayTransitions);
 	connect(ui.display_variations, &QAbstractButton::toggled, plannerModel, &DivePlannerPointsModel::setDisplayVariations);
+	connect(ui.display_variations, &QAbstractButton::toggled, ui.variationsGrid, &QWidget::setEnabled);
+	connect(ui.variations_depth_steps, QOverload<int>::of(&QSpinBox::valueChanged), plannerModel, &DivePlannerPointsModel::setVariationsDepthSteps);
+	connect(ui.variations_time_steps, QOverload<int>::of(&QSpinBox::valueChanged), plannerModel, &DivePlannerPointsModel::setVariationsTimeSteps);
+	connect(ui.variations_gf_steps, QOverload<int>::of(&QSpinBox::valueChanged), plannerModel, &DivePlannerPointsModel::setVariationsGfSteps);
+	connect(ui.variations_table, &QAbstractButton::toggled, plannerModel, &DivePlannerPointsModel::setVariationsTable);
 	connect(ui.safetystop, &QAbstractButton::toggled, plannerModel, &DivePlannerPointsModel::setSafetyStop);
 	connect(ui.reserve_gas, QOverload<int>::of(&QSpinBox::valueChanged), &PlannerShared::set_reserve_gas);
 	connect(ui.ascRate75, QOverload<int>::of(&QSpinBox::valueChanged), plannerModel, &DivePlannerPointsModel::setAscrate75Display);
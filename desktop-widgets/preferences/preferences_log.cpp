@@ -72,6 +72,7 @@ void PreferencesLog::refreshSettings()
 	ui->displayinvalid->setChecked(qPrefDisplay::display_invalid_dives());
 	ui->extraEnvironmentalDefault->setChecked(prefs.extraEnvironmentalDefault);
 	ui->salinityEditDefault->setChecked(prefs.salinityEditDefault);
+	ui->git_binary_samples->setChecked(prefs.git_binary_samples);
 }
 
 void PreferencesLog::syncSettings()
@@ -92,6 +93,7 @@ void PreferencesLog::syncSettings()
 	qPrefDisplay::set_display_invalid_dives(ui->displayinvalid->isChecked());
 	qPrefLog::set_extraEnvironmentalDefault(ui->extraEnvironmentalDefault->isChecked());
 	qPrefLog::set_salinityEditDefault(ui->salinityEditDefault->isChecked());
+	qPrefLog::set_git_binary_samples(ui->git_binary_samples->isChecked());
 
 	// TODO: Move to preferences code?
 	if (displayinvalid_changed)
@@ -73,6 +73,7 @@ void PreferencesMedia::refreshSettings()
 	ui->ffmpegExecutable->setText(qPrefMedia::ffmpeg_executable());
 
 	ui->auto_recalculate_thumbnails->setChecked(prefs.auto_recalculate_thumbnails);
+	ui->thumbnail_threads->setValue(qPrefMedia::thumbnail_threads());
 }
 
 void PreferencesMedia::syncSettings()
@@ -82,4 +83,5 @@ void PreferencesMedia::syncSettings()
 	media->set_extract_video_thumbnails_position(ui->videoThumbnailPosition->value());
 	media->set_ffmpeg_executable(ui->ffmpegExecutable->text());
 	qPrefMedia::set_auto_recalculate_thumbnails(ui->auto_recalculate_thumbnails->isChecked());
+	qPrefMedia::set_thumbnail_threads(ui->thumbnail_threads->value());
 }
@@ -114,7 +114,7 @@ void DivePercentageItem::replot(const dive *d, const struct divecomputer *dc, co
 			if (nextX == x)
 				continue;
 
-			double value = item.percentages[tissue];
+			double value = get_plot_tissue_percentage(pi, i, tissue);
 			struct gasmix gasmix = loop.at(sec).first;
 			int inert = get_n2(gasmix) + get_he(gasmix);
 			color = colorScale(value, inert);
@@ -14,7 +14,7 @@
 AbstractProfilePolygonItem::AbstractProfilePolygonItem(const plot_info &pInfo, const DiveCartesianAxis &horizontal,
 						       const DiveCartesianAxis &vertical, DataAccessor accessor,
 						       double dpr) :
-	hAxis(horizontal), vAxis(vertical), pInfo(pInfo), accessor(accessor), dpr(dpr), from(0), to(0)
+	hAxis(horizontal), vAxis(vertical), pInfo(pInfo), accessor(accessor), dpr(dpr), from(0), to(0), lodBuilt(false)
 {
 	setCacheMode(DeviceCoordinateCache);
 }
@@ -26,7 +26,90 @@ AbstractProfilePolygonItem::~AbstractProfilePolygonItem()
 void AbstractProfilePolygonItem::clear()
 {
 	setPolygon(QPolygonF());
+	indices.clear();
 	texts.clear();
+	invalidateLod();
+}
+
+void AbstractProfilePolygonItem::invalidateLod()
+{
+	lod.clear();
+	lodBuilt = false;
+}
+
+// Samples for which this returns false are not plotted (e.g. missing temperatures)
+bool AbstractProfilePolygonItem::lodValid(double) const
+{
+	return true;
+}
+
+void AbstractProfilePolygonItem::buildLod()
+{
+	lod.clear();
+	lodBuilt = true;
+
+	// Start with blocks of one sample and merge pairs of blocks for every level.
+	// A block without valid samples is marked by an index of -1.
+	std::vector<LodBlock> level(pInfo.nr);
+	for (int i = 0; i < pInfo.nr; i++) {
+		int idx = lodValid(accessor(pInfo, i)) ? i : -1;
+		level[i] = { idx, idx };
+	}
+	while (level.size() > 1) {
+		std::vector<LodBlock> next((level.size() + 1) / 2);
+		for (size_t i = 0; i < next.size(); i++) {
+			LodBlock a = level[2 * i];
+			LodBlock b = 2 * i + 1 < level.size() ? level[2 * i + 1] : LodBlock{ -1, -1 };
+			next[i].min = a.min < 0 || (b.min >= 0 && accessor(pInfo, b.min) < accessor(pInfo, a.min)) ? b.min : a.min;
+			next[i].max = a.max < 0 || (b.max >= 0 && accessor(pInfo, b.max) > accessor(pInfo, a.max)) ? b.max : a.max;
+		}
+		lod.push_back(next);
+		level = std::move(next);
+	}
+}
+
+// The indexes of the samples to plot for the range (from, to). If there are
+// many samples per pixel, only the minimum and the maximum of blocks that are
+// at most one pixel wide are plotted, which looks the same as plotting all of
+// them. The pyramid is built once per plot info, so that the number of
+// points is bounded by the width of the view, whatever the zoom level.
+std::vector<int> AbstractProfilePolygonItem::lodIndices(int from, int to)
+{
+	std::vector<int> res;
+	if (from >= to)
+		return res;
+
+	// The axis works in device independent pixels.
+	double pixels = fabs(hAxis.posAtValue(pInfo.entry[to - 1].sec) - hAxis.posAtValue(pInfo.entry[from].sec)) * dpr;
+	double samplesPerPixel = (to - from) / std::max(pixels, 1.0);
+	if (samplesPerPixel < 2.0) {
+		res.reserve(to - from);
+		for (int i = from; i < to; i++)
+			res.push_back(i);
+		return res;
+	}
+
+	if (!lodBuilt)
+		buildLod();
+	size_t level = 0; // Blocks of 2^(level+1) samples
+	while (level + 1 < lod.size() && (4 << level) <= samplesPerPixel)
+		level++;
+	int shift = level + 1;
+
+	// The first and the last sample are always plotted, since they are clipped
+	res.push_back(from);
+	for (int block = from >> shift; block <= (to - 1) >> shift && block < (int)lod[level].size(); block++) {
+		auto [min, max] = lod[level][block];
+		if (min > max)
+			std::swap(min, max);
+		for (int idx: { min, max }) {
+			if (idx > res.back() && idx < to - 1)
+				res.push_back(idx);
+		}
+	}
+	if (to - 1 > from)
+		res.push_back(to - 1);
+	return res;
 }
 
 static std::pair<double,double> clip(double x1, double y1, double x2, double y2, double x)
@@ -51,17 +134,17 @@ std::pair<double, double> AbstractProfilePolygonItem::getPoint(int i) const
 {
 	const auto &data = pInfo.entry;
 	double x = data[i].sec;
-	double y = accessor(data[i]);
+	double y = accessor(pInfo, i);
 
 	// Do clipping of first and last value
 	if (i == from && i < to) {
 		double next_x = data[i+1].sec;
-		double next_y = accessor(data[i+1]);
+		double next_y = accessor(pInfo, i + 1);
 		clipStart(x, y, next_x, next_y);
 	}
 	if (i == to - 1 && i > 0) {
 		double prev_x = data[i-1].sec;
-		double prev_y = accessor(data[i-1]);
+		double prev_y = accessor(pInfo, i - 1);
 		clipStop(x, y, prev_x, prev_y);
 	}
 
@@ -72,6 +155,7 @@ void AbstractProfilePolygonItem::makePolygon(int fromIn, int toIn)
 {
 	from = fromIn;
 	to = toIn;
+	indices = lodIndices(from, to);
 
 	// Calculate the polygon. This is the polygon that will be painted on screen
 	// on the ::paint method. Here we calculate the correct position of the points
@@ -79,7 +163,7 @@ void AbstractProfilePolygonItem::makePolygon(int fromIn, int toIn)
 	// is an array of QPointF's, so we basically get the point from the model, convert
 	// to our coordinates, store. no painting is done here.
 	QPolygonF poly;
-	for (int i = from; i < to; i++) {
+	for (int i: indices) {
 		auto [horizontalValue, verticalValue] = getPoint(i);
 
 		if (i == from) {
@@ -123,12 +207,12 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 	QPolygonF poly = polygon();
 	const auto &data = pInfo.entry;
 	// This paints the colors of the velocities.
-	for (int i = from + 1; i < to; i++) {
-		QColor color = getColor((color_index_t)(VELOCITY_COLORS_START_IDX + data[i].velocity));
+	for (int i = 1; i < (int)indices.size(); i++) {
+		QColor color = getColor((color_index_t)(VELOCITY_COLORS_START_IDX + data[indices[i]].velocity));
 		pen.setBrush(QBrush(color));
 		painter->setPen(pen);
-		if (i - from < poly.count() - 1)
-			painter->drawLine(poly[i - from], poly[i - from + 1]);
+		if (i < poly.count() - 1)
+			painter->drawLine(poly[i], poly[i + 1]);
 	}
 	painter->restore();
 }
@@ -150,13 +234,13 @@ void DiveProfileItem::replot(const dive *d, int from, int to, bool in_planner)
 	/* Show any ceiling we may have encountered */
 	if (prefs.dcceiling && !prefs.redceiling) {
 		QPolygonF p = polygon();
-		auto entry = pInfo.entry.begin() + (to - 1);
-		for (int i = to - 1; i >= from; i--, entry--) {
-			if (!entry->in_deco) {
+		for (auto it = indices.rbegin(); it != indices.rend(); ++it) {
+			const plot_data &entry = pInfo.entry[*it];
+			if (!entry.in_deco) {
 				/* not in deco implies this is a safety stop, no ceiling */
-				p.append(QPointF(hAxis.posAtValue(entry->sec), vAxis.posAtValue(0)));
+				p.append(QPointF(hAxis.posAtValue(entry.sec), vAxis.posAtValue(0)));
 			} else {
-				p.append(QPointF(hAxis.posAtValue(entry->sec), vAxis.posAtValue(qMin(entry->stopdepth, entry->depth))));
+				p.append(QPointF(hAxis.posAtValue(entry.sec), vAxis.posAtValue(qMin(entry.stopdepth, entry.depth))));
 			}
 		}
 		setPolygon(p);
@@ -286,7 +370,7 @@ void DiveHeartrateItem::replot(const dive *, int fromIn, int toIn, bool)
 	// Ignore empty values. a heart rate of 0 would be a bad sign.
 	QPolygonF poly;
 	int interval = vAxis.getMinLabelDistance(hAxis);
-	for (int i = from; i < to; i++) {
+	for (int i: lodIndices(from, to)) {
 		auto [sec_double, hr_double] = getPoint(i);
 		int hr = lrint(hr_double);
 		if (!hr)
@@ -328,6 +412,11 @@ void DiveHeartrateItem::replot(const dive *, int fromIn, int toIn, bool)
 	}
 }
 
+bool DiveHeartrateItem::lodValid(double hr) const
+{
+	return lrint(hr) != 0;
+}
+
 void DiveHeartrateItem::createTextItem(int sec, int hr, bool last)
 {
 	int flags = last ? Qt::AlignLeft | Qt::AlignBottom :
@@ -371,7 +460,7 @@ void DiveTemperatureItem::replot(const dive *, int fromIn, int toIn, bool)
 	// Ignore empty values. things do not look good with '0' as temperature in kelvin...
 	QPolygonF poly;
 	int interval = vAxis.getMinLabelDistance(hAxis);
-	for (int i = from; i < to; i++) {
+	for (int i: lodIndices(from, to)) {
 		auto [sec, mkelvin] = getPoint(i);
 		if (mkelvin < 1.0)
 			continue;
@@ -408,6 +497,11 @@ void DiveTemperatureItem::replot(const dive *, int fromIn, int toIn, bool)
 	}
 }
 
+bool DiveTemperatureItem::lodValid(double mkelvin) const
+{
+	return mkelvin >= 1.0;
+}
+
 void DiveTemperatureItem::createTextItem(int sec, int mkelvin, bool last)
 {
 	temperature_t temp;
@@ -469,6 +563,11 @@ std::pair<double,double> DiveMeanDepthItem::getNextMeanDepth(int first) const
 	return getMeanDepth(first);
 }
 
+bool DiveMeanDepthItem::lodValid(double meanDepth) const
+{
+	return meanDepth > 0.0;
+}
+
 void DiveMeanDepthItem::replot(const dive *, int fromIn, int toIn, bool)
 {
 	from = fromIn;
@@ -477,7 +576,7 @@ void DiveMeanDepthItem::replot(const dive *, int fromIn, int toIn, bool)
 	double prevSec = 0.0, prevMeanDepth = 0.0;
 
 	QPolygonF poly;
-	for (int i = from; i < to; i++) {
+	for (int i: lodIndices(from, to)) {
 		auto [sec, meanDepth] = getMeanDepth(i);
 		// Ignore empty values
 		if (meanDepth == 0)
@@ -721,9 +820,7 @@ DiveReportedCeiling::DiveReportedCeiling(const plot_info &pInfo, const DiveCarte
 
 std::pair<double,double> DiveReportedCeiling::getTimeValue(int i) const
 {
-	const plot_data &entry = pInfo.entry[i];
-	int value = entry.in_deco && entry.stopdepth ? std::min(entry.stopdepth, entry.depth) : 0;
-	return { static_cast<double>(entry.sec), static_cast<double>(value) };
+	return { static_cast<double>(pInfo.entry[i].sec), accessor(pInfo, i) };
 }
 
 std::pair<double, double> DiveReportedCeiling::getPoint(int i) const
@@ -746,7 +843,7 @@ void DiveReportedCeiling::replot(const dive *, int fromIn, int toIn, bool)
 	to = toIn;
 
 	QPolygonF p;
-	for (int i = from; i < to; i++) {
+	for (int i: lodIndices(from, to)) {
 		auto [sec, value] = getPoint(i);
 		if (i == from)
 			p.append(QPointF(hAxis.posAtValue(sec), vAxis.posAtValue(0.0)));
@@ -790,7 +887,7 @@ void PartialPressureGasItem::replot(const dive *, int fromIn, int toIn, bool)
 	if (thresholdPtrMin)
 		threshold_min = *thresholdPtrMin;
 	bool inAlertFragment = false;
-	for (int i = from; i < to; i++) {
+	for (int i: lodIndices(from, to)) {
 		auto [time, value] = getPoint(i);
 		QPointF point(hAxis.posAtValue(time), vAxis.posAtValue(value));
 		poly.push_back(point);
@@ -26,12 +26,13 @@ struct dive;
 
 class AbstractProfilePolygonItem : public QGraphicsPolygonItem {
 public:
-	using DataAccessor = double (*)(const plot_data &data); // The pointer-to-function syntax is hilarious.
+	using DataAccessor = double (*)(const plot_info &pi, int idx); // The pointer-to-function syntax is hilarious.
 	AbstractProfilePolygonItem(const plot_info &pInfo, const DiveCartesianAxis &hAxis, const DiveCartesianAxis &vAxis,
 				   DataAccessor accessor, double dpr);
 	~AbstractProfilePolygonItem();
 	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0) = 0;
 	void clear();
+	void invalidateLod(); // To be called when the plot info changed
 
 	// Plot the range (from, to), given as indexes. The caller guarantees that
 	// only the first and the last segment will have to be clipped.
@@ -39,6 +40,8 @@ public:
 
 protected:
 	void makePolygon(int from, int to);
+	std::vector<int> lodIndices(int from, int to);
+	virtual bool lodValid(double value) const;
 	void clipStart(double &x, double &y, double next_x, double next_y) const;
 	void clipStop(double &x, double &y, double prev_x, double prev_y) const;
 	std::pair<double, double> getPoint(int i) const;
@@ -48,7 +51,18 @@ protected:
 	DataAccessor accessor;
 	double dpr;
 	int from, to;
+	std::vector<int> indices; // The samples plotted by makePolygon()
 	std::vector<std::unique_ptr<DiveTextItem>> texts;
+
+private:
+	// Level-of-detail pyramid: for level l, the indexes of the minimum and
+	// maximum value in every block of 2^(l+1) consecutive samples.
+	struct LodBlock {
+		int min, max;
+	};
+	std::vector<std::vector<LodBlock>> lod;
+	bool lodBuilt;
+	void buildLod();
 };
 
 class DiveProfileItem : public AbstractProfilePolygonItem {
@@ -73,6 +87,7 @@ public:
 	double labelWidth;
 
 private:
+	bool lodValid(double meanDepth) const override;
 	void createTextItem(double lastSec, double lastMeanDepth);
 	std::pair<double,double> getMeanDepth(int i) const;
 	std::pair<double,double> getNextMeanDepth(int i) const;
@@ -86,6 +101,7 @@ public:
 	void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0) override;
 
 private:
+	bool lodValid(double mkelvin) const override;
 	void createTextItem(int seconds, int mkelvin, bool last);
 };
 
@@ -97,6 +113,7 @@ public:
 	void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
 
 private:
+	bool lodValid(double hr) const override;
 	void createTextItem(int seconds, int hr, bool last);
 };
 
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "profile-widget/plotinfoloader.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/divelog.h"
+#include "core/plotinfocache.h"
+#include "core/subsurface-qt/divelistnotifier.h"
+
+#include <QtConcurrent>
+#include <QDeadlineTimer>
+#include <algorithm>
+
+PlotInfoLoader::PlotInfoLoader()
+{
+	// Any edit may change the profile or the deco history of a dive.
+	connect(&diveListNotifier, &DiveListNotifier::commandExecuted, this, &PlotInfoLoader::clear);
+	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &PlotInfoLoader::clear);
+	connect(&diveListNotifier, &DiveListNotifier::divesImported, this, &PlotInfoLoader::clear);
+}
+
+PlotInfoLoader *PlotInfoLoader::instance()
+{
+	static PlotInfoLoader self;
+	return &self;
+}
+
+std::vector<std::shared_ptr<PlotInfoLoader::Job>>::iterator PlotInfoLoader::find(const struct dive *d, int dc)
+{
+	return std::find_if(jobs.begin(), jobs.end(),
+			    [d, dc](const std::shared_ptr<Job> &job) { return job->d == d && job->dc == dc; });
+}
+
+void PlotInfoLoader::run(std::shared_ptr<Job> job, std::shared_ptr<const dive_table> snapshot)
+{
+	if (!job->cancelled) {
+		// The copy of the dive is the last dive of the snapshot.
+		const struct dive *d = snapshot->back().get();
+		plot_info pi = create_plot_info_new(*snapshot, job->decoSettings, d, d->get_dc(job->dc), nullptr);
+		// The deco settings are the ones of the request, but the other preferences
+		// are read during the calculation. If they changed, the result doesn't
+		// belong to the hash of the request.
+		bool stale = plot_info_prefs_hash(job->decoSettings) != job->prefsHash;
+		QMutexLocker l(&lock);
+		job->pi = std::move(pi);
+		job->stale = stale;
+	}
+	{
+		QMutexLocker l(&lock);
+		job->finished = true;
+	}
+	finishedCondition.wakeAll();
+	// Emit the signal from the UI thread, where the jobs are cancelled.
+	QMetaObject::invokeMethod(this, [this, job]() {
+		if (!job->cancelled)
+			emit ready(job->d, job->dc);
+	}, Qt::QueuedConnection);
+}
+
+void PlotInfoLoader::request(const struct dive *d, int dc)
+{
+	if (!d || PlotInfoCache::instance()->find(d, dc))
+		return;
+	struct deco_settings decoSettings = default_deco_settings();
+	uint64_t prefsHash = plot_info_prefs_hash(decoSettings);
+	auto it = find(d, dc);
+	if (it != jobs.end()) {
+		if ((*it)->prefsHash == prefsHash && !isStale(**it))
+			return;
+		(*it)->cancelled = true;
+		jobs.erase(it);
+	}
+
+	auto job = std::make_shared<Job>();
+	job->d = d;
+	job->dc = dc;
+	job->decoSettings = decoSettings;
+	job->prefsHash = prefsHash;
+	auto snapshot = std::make_shared<const dive_table>(divelog.dives.deco_snapshot(*d));
+	jobs.push_back(job);
+	QtConcurrent::run(&pool, [this, job, snapshot]() { run(job, snapshot); });
+}
+
+std::optional<plot_info> PlotInfoLoader::take(const struct dive *d, int dc, int timeout)
+{
+	if (std::optional<plot_info> pi = PlotInfoCache::instance()->find(d, dc))
+		return pi;
+	auto it = find(d, dc);
+	if (it == jobs.end())
+		return {};
+	std::shared_ptr<Job> job = *it;
+	if (job->prefsHash != plot_info_prefs_hash()) {
+		job->cancelled = true;
+		jobs.erase(it);
+		return {};
+	}
+
+	QMutexLocker l(&lock);
+	QDeadlineTimer deadline(timeout);
+	while (!job->finished) {
+		if (!finishedCondition.wait(&lock, deadline))
+			return {};
+	}
+	jobs.erase(std::remove(jobs.begin(), jobs.end(), job), jobs.end());
+	if (job->stale)
+		return {};
+	PlotInfoCache::instance()->put(d, dc, job->pi, job->prefsHash);
+	return std::move(job->pi);
+}
+
+bool PlotInfoLoader::isStale(const Job &job)
+{
+	QMutexLocker l(&lock);
+	return job.stale;
+}
+
+void PlotInfoLoader::prefetch(const struct dive *current, const std::vector<const struct dive *> &neighbours)
+{
+	// Calculations that already started are not interrupted,
+	// but their results are discarded.
+	auto keep = [current, &neighbours](const std::shared_ptr<Job> &job) {
+		return job->d == current ||
+		       std::find(neighbours.begin(), neighbours.end(), job->d) != neighbours.end();
+	};
+	for (auto it = jobs.begin(); it != jobs.end(); ) {
+		if (keep(*it)) {
+			++it;
+		} else {
+			(*it)->cancelled = true;
+			it = jobs.erase(it);
+		}
+	}
+
+	for (const struct dive *d: neighbours)
+		request(d, 0);
+}
+
+void PlotInfoLoader::clear()
+{
+	if (jobs.empty())
+		return;
+	for (auto &job: jobs)
+		job->cancelled = true;
+	jobs.clear();
+	emit cancelled();
+}
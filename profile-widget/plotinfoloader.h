@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0
+// Calculates the plot info of dives in a background thread, so that
+// selecting a dive with a long deco history doesn't block the UI.
+#ifndef PLOTINFOLOADER_H
+#define PLOTINFOLOADER_H
+
+#include "core/profile.h"
+
+#include <QObject>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
+struct dive;
+
+class PlotInfoLoader : public QObject {
+	Q_OBJECT
+public:
+	static PlotInfoLoader *instance();
+
+	// Start the calculation of the plot info of the given dive computer,
+	// unless it is already running, finished or in the PlotInfoCache. Must be called from
+	// the UI thread, because the dive and its deco history are copied.
+	void request(const struct dive *d, int dc);
+
+	// Remove the result of a request from the loader. Waits at most
+	// timeout milliseconds for the calculation to finish and returns
+	// nothing if it didn't finish in time, was never requested or the
+	// preferences changed during the calculation.
+	std::optional<plot_info> take(const struct dive *d, int dc, int timeout);
+
+	// Cancel the calculations for dives other than the current dive and
+	// its neighbours and request the first dive computer of the neighbours.
+	void prefetch(const struct dive *current, const std::vector<const struct dive *> &neighbours);
+
+	// Drop all results, for example because the dives were edited.
+	// Emits cancelled() if calculations were dropped.
+	void clear();
+signals:
+	// Emitted in the UI thread, when a calculation finished.
+	void ready(const struct dive *d, int dc);
+	// Emitted when clear() dropped calculations. Their ready() signal never
+	// comes, so whoever waits for one of them has to request it again.
+	void cancelled();
+private:
+	struct Job {
+		const struct dive *d; // Only used as key, never dereferenced by the worker
+		int dc;
+		struct deco_settings decoSettings; // Copied on request, not read from the preferences by the worker
+		uint64_t prefsHash; // Of the preferences at the time of the request
+		std::atomic<bool> cancelled = false;
+		bool finished = false; // Protected by lock
+		bool stale = false; // Preferences changed during the calculation. Protected by lock
+		plot_info pi;
+	};
+
+	PlotInfoLoader();
+	void run(std::shared_ptr<Job> job, std::shared_ptr<const dive_table> snapshot);
+	std::vector<std::shared_ptr<Job>>::iterator find(const struct dive *d, int dc);
+	bool isStale(const Job &job);
+
+	QMutex lock;
+	QWaitCondition finishedCondition;
+	QThreadPool pool;
+	std::vector<std::shared_ptr<Job>> jobs; // Only accessed from the UI thread
+};
+
+#endif // PLOTINFOLOADER_H
@@ -12,6 +12,7 @@
 #include "core/divecomputer.h"
 #include "core/event.h"
 #include "core/pref.h"
+#include "core/plotinfocache.h"
 #include "core/profile.h"
 #include "core/qthelper.h"	// for decoMode()
 #include "core/range.h"
@@ -69,9 +70,9 @@ PartialPressureGasItem *ProfileScene::createPPGas(DataAccessor accessor, color_i
 }
 
 template <int IDX>
-double accessTissue(const plot_data &item)
+double accessTissue(const plot_info &pi, int idx)
 {
-	return item.ceilings[IDX];
+	return get_plot_tissue_ceiling(pi, idx, IDX);
 }
 
 // For now, the accessor functions for the profile data do not possess a payload.
@@ -111,43 +112,44 @@ ProfileScene::ProfileScene(double dpr, bool printMode, bool isGrayscale) :
 	percentageAxis(new DiveCartesianAxis(DiveCartesianAxis::Position::Right, false, 2, 0, TIME_GRID, Qt::black, false, false,
 					     dpr, 0.7, printMode, isGrayscale, *this)),
 	diveProfileItem(createItem<DiveProfileItem>(*profileYAxis,
-						    [](const plot_data &item) { return (double)item.depth; },
+						    [](const plot_info &pi, int i) { return (double)pi.entry[i].depth; },
 						    0, dpr)),
 	temperatureItem(createItem<DiveTemperatureItem>(*temperatureAxis,
-							[](const plot_data &item) { return (double)item.temperature; },
+							[](const plot_info &pi, int i) { return (double)pi.entry[i].temperature; },
 							1, dpr)),
 	meanDepthItem(createItem<DiveMeanDepthItem>(*profileYAxis,
-						    [](const plot_data &item) { return (double)item.running_sum; },
+						    [](const plot_info &pi, int i) { return pi.entry[i].sec > 0 ? (double)pi.entry[i].running_sum / pi.entry[i].sec : 0.0; },
 						    1, dpr)),
 	gasPressureItem(createItem<DiveGasPressureItem>(*cylinderPressureAxis,
-							[](const plot_data &item) { return 0.0; }, // unused
+							[](const plot_info &pi, int i) { return 0.0; }, // unused
 							1, dpr)),
 	diveComputerText(new DiveTextItem(dpr, 1.0, Qt::AlignRight | Qt::AlignTop, nullptr)),
 	reportedCeiling(createItem<DiveReportedCeiling>(*profileYAxis,
-							[](const plot_data &item) { return (double)item.ceiling; },
+							[](const plot_info &pi, int i) { const plot_data &entry = pi.entry[i];
+											 return entry.in_deco && entry.stopdepth ? (double)std::min(entry.stopdepth, entry.depth) : 0.0; },
 							1, dpr)),
-	pn2GasItem(createPPGas([](const plot_data &item) { return (double)item.pressures.n2; },
+	pn2GasItem(createPPGas([](const plot_info &pi, int i) { return (double)pi.entry[i].pressures.n2; },
 			       PN2, PN2_ALERT, NULL, &prefs.pp_graphs.pn2_threshold)),
-	pheGasItem(createPPGas([](const plot_data &item) { return (double)item.pressures.he; },
+	pheGasItem(createPPGas([](const plot_info &pi, int i) { return (double)pi.entry[i].pressures.he; },
 			       PHE, PHE_ALERT, NULL, &prefs.pp_graphs.phe_threshold)),
-	po2GasItem(createPPGas([](const plot_data &item) { return (double)item.pressures.o2; },
+	po2GasItem(createPPGas([](const plot_info &pi, int i) { return (double)pi.entry[i].pressures.o2; },
 			       PO2, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	o2SetpointGasItem(createPPGas([](const plot_data &item) { return item.o2setpoint.mbar / 1000.0; },
+	o2SetpointGasItem(createPPGas([](const plot_info &pi, int i) { return pi.entry[i].o2setpoint.mbar / 1000.0; },
 				      O2SETPOINT, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	ccrsensor1GasItem(createPPGas([](const plot_data &item) { return item.o2sensor[0].mbar / 1000.0; },
+	ccrsensor1GasItem(createPPGas([](const plot_info &pi, int i) { return pi.entry[i].o2sensor[0].mbar / 1000.0; },
 				      CCRSENSOR1, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	ccrsensor2GasItem(createPPGas([](const plot_data &item) { return item.o2sensor[1].mbar / 1000.0; },
+	ccrsensor2GasItem(createPPGas([](const plot_info &pi, int i) { return pi.entry[i].o2sensor[1].mbar / 1000.0; },
 				      CCRSENSOR2, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	ccrsensor3GasItem(createPPGas([](const plot_data &item) { return item.o2sensor[2].mbar / 1000.0; },
+	ccrsensor3GasItem(createPPGas([](const plot_info &pi, int i) { return pi.entry[i].o2sensor[2].mbar / 1000.0; },
 				      CCRSENSOR3, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	ocpo2GasItem(createPPGas([](const plot_data &item) { return item.scr_OC_pO2.mbar / 1000.0; },
+	ocpo2GasItem(createPPGas([](const plot_info &pi, int i) { return pi.entry[i].scr_OC_pO2.mbar / 1000.0; },
 				 SCR_OCPO2, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
 	diveCeiling(createItem<DiveCalculatedCeiling>(*profileYAxis,
-						      [](const plot_data &item) { return (double)item.ceiling; },
+						      [](const plot_info &pi, int i) { return (double)pi.entry[i].ceiling; },
 						      1, dpr)),
 	decoModelParameters(new DiveTextItem(dpr, 1.0, Qt::AlignHCenter | Qt::AlignTop, nullptr)),
 	heartBeatItem(createItem<DiveHeartrateItem>(*heartBeatAxis,
-						    [](const plot_data &item) { return (double)item.heartbeat; },
+						    [](const plot_info &pi, int i) { return (double)pi.entry[i].heartbeat; },
 						    1, dpr)),
 	percentageItem(new DivePercentageItem(*timeAxis, *percentageAxis)),
 	tankItem(new TankItem(*timeAxis, dpr)),
@@ -204,6 +206,14 @@ void ProfileScene::clear()
 	empty = true;
 }
 
+void ProfileScene::setPlotInfo(plot_info pi)
+{
+	plotInfo = std::move(pi);
+	for (AbstractProfilePolygonItem *item: profileItems)
+		item->invalidateLod();
+	empty = false;
+}
+
 static bool ppGraphsEnabled(const struct divecomputer *dc, bool simplified)
 {
 	return simplified ? (dc->divemode == CCR && prefs.pp_graphs.po2)
@@ -451,9 +461,18 @@ void ProfileScene::plotDive(const struct dive *dIn, int dcIn, DivePlannerPointsM
 	 * so I'll *not* calculate everything if something is not being
 	 * shown.
 	 * create_plot_info_new() automatically frees old plot data.
+	 * Passing in the old plot data lets it skip the deco calculation
+	 * up to the first changed entry.
 	 */
-	if (!keepPlotInfo)
-		plotInfo = create_plot_info_new(d, currentdc, planner_ds);
+	if (!keepPlotInfo) {
+		// Plot infos outside of the planner and edit mode are shared with printing and export.
+		if (plannerModel)
+			plotInfo = create_plot_info_new(d, currentdc, planner_ds, &plotInfo);
+		else
+			plotInfo = PlotInfoCache::instance()->get(d, dc, &plotInfo);
+		for (AbstractProfilePolygonItem *item: profileItems)
+			item->invalidateLod();
+	}
 
 	bool hasHeartBeat = plotInfo.maxhr;
 	// For mobile we might want to turn of some features that are normally shown.
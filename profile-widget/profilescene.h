@@ -45,6 +45,10 @@ public:
 	void plotDive(const struct dive *d, int dc, DivePlannerPointsModel *plannerModel = nullptr, bool inPlanner = false,
 		      bool instant = false, bool keepPlotInfo = false, bool calcMax = true, double zoom = 1.0, double zoomedPosition = 0.0);
 
+	// Use a plot info that was calculated elsewhere, e.g. in a background thread.
+	// Pass keepPlotInfo to the next call to plotDive().
+	void setPlotInfo(plot_info pi);
+
 	void draw(QPainter *painter, const QRect &pos,
 		  const struct dive *d, int dc,
 		  DivePlannerPointsModel *plannerModel = nullptr, bool inPlanner = false);
@@ -53,7 +57,7 @@ public:
 	const struct dive *d;
 	int dc;
 private:
-	using DataAccessor = double (*)(const plot_data &data);
+	using DataAccessor = double (*)(const plot_info &pi, int idx);
 	template<typename T, class... Args> T *createItem(const DiveCartesianAxis &vAxis, DataAccessor accessor, int z, Args&&... args);
 	PartialPressureGasItem *createPPGas(DataAccessor accessor, color_index_t color, color_index_t colorAlert,
 					    const double *thresholdSettingsMin, const double *thresholdSettingsMax);
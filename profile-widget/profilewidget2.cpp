@@ -13,6 +13,7 @@
 #include "profile-widget/divetextitem.h"
 #include "profile-widget/divetooltipitem.h"
 #include "profile-widget/divehandler.h"
+#include "profile-widget/plotinfoloader.h"
 #include "core/planner.h"
 #include "profile-widget/ruleritem.h"
 #include "core/pref.h"
@@ -60,6 +61,7 @@ ProfileWidget2::ProfileWidget2(DivePlannerPointsModel *plannerModelIn, double dp
 	d(nullptr),
 	dc(0),
 	empty(true),
+	pendingPlot(false),
 	panning(false),
 #ifndef SUBSURFACE_MOBILE
 	mouseFollowerVertical(new DiveLineItem()),
@@ -84,6 +86,8 @@ ProfileWidget2::ProfileWidget2(DivePlannerPointsModel *plannerModelIn, double dp
 	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &ProfileWidget2::divesChanged);
 	connect(&diveListNotifier, &DiveListNotifier::deviceEdited, this, &ProfileWidget2::replot);
 	connect(&diveListNotifier, &DiveListNotifier::diveComputerEdited, this, &ProfileWidget2::replot);
+	connect(PlotInfoLoader::instance(), &PlotInfoLoader::ready, this, &ProfileWidget2::plotInfoReady);
+	connect(PlotInfoLoader::instance(), &PlotInfoLoader::cancelled, this, &ProfileWidget2::plotInfoCancelled);
 #endif // SUBSURFACE_MOBILE
 
 #if !defined(QT_NO_DEBUG) && defined(SHOW_PLOT_INFO_TABLE)
@@ -208,11 +212,37 @@ void ProfileWidget2::plotDive(const struct dive *dIn, int dcIn, int flags)
 
 	DivePlannerPointsModel *model = currentState == EDIT || currentState == PLAN ? plannerModel : nullptr;
 	bool inPlanner = currentState == PLAN;
+	bool keepPlotInfo = flags & RenderFlags::DontRecalculatePlotInfo;
+
+#ifndef SUBSURFACE_MOBILE
+	// The plot info of a newly selected dive is calculated in the background,
+	// since the deco of all preceding dives may have to be calculated.
+	// If it isn't finished within a frame, show an empty profile and replot
+	// once it is ready. Edits and the planner are calculated synchronously,
+	// because there the previous plot info is used for incremental updates.
+	const struct divecomputer *currentdc = d->get_dc(dc);
+	pendingPlot = false;
+	if (!model && !keepPlotInfo && currentdc && !currentdc->samples.empty() &&
+	    (profileScene->empty || profileScene->d != d || profileScene->dc != dc)) {
+		PlotInfoLoader *loader = PlotInfoLoader::instance();
+		loader->request(d, dc);
+		std::optional<plot_info> pi = loader->take(d, dc, 16);
+		if (!pi) {
+			pendingPlot = true;
+			clearPictures();
+			profileScene->clear();
+			toolTipItem->setPlotInfo(profileScene->plotInfo);
+			rulerItem->setPlotInfo(d, profileScene->plotInfo);
+			return;
+		}
+		profileScene->setPlotInfo(std::move(*pi));
+		keepPlotInfo = true;
+	}
+#endif
 
 	double zoom = calcZoom(zoomLevel);
 	profileScene->plotDive(d, dc, model, inPlanner, flags & RenderFlags::Instant,
-			       flags & RenderFlags::DontRecalculatePlotInfo,
-			       shouldCalculateMax, zoom, zoomedPosition);
+			       keepPlotInfo, shouldCalculateMax, zoom, zoomedPosition);
 
 #ifndef SUBSURFACE_MOBILE
 	toolTipItem->setVisible(prefs.infobox);
@@ -253,6 +283,20 @@ void ProfileWidget2::divesChanged(const QVector<dive *> &dives, DiveField field)
 		replot();
 }
 
+void ProfileWidget2::plotInfoReady(const struct dive *dIn, int dcIn)
+{
+	if (pendingPlot && dIn == d && dcIn == dc)
+		plotDive(d, dc, RenderFlags::Instant);
+}
+
+// The calculation we were waiting for was dropped, because the dives were
+// edited. Request it again.
+void ProfileWidget2::plotInfoCancelled()
+{
+	if (pendingPlot && d)
+		plotDive(d, dc, RenderFlags::Instant);
+}
+
 void ProfileWidget2::actionRequestedReplot(bool)
 {
 	settingsChanged();
@@ -409,6 +453,7 @@ void ProfileWidget2::clear()
 	handles.clear();
 	gases.clear();
 	empty = true;
+	pendingPlot = false;
 	d = nullptr;
 	dc = 0;
 }
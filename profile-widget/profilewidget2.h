@@ -74,6 +74,8 @@ slots: // Necessary to call from QAction's signals.
 	void settingsChanged();
 	void actionRequestedReplot(bool triggered);
 	void divesChanged(const QVector<dive *> &dives, DiveField field);
+	void plotInfoReady(const struct dive *d, int dc);
+	void plotInfoCancelled();
 #ifndef SUBSURFACE_MOBILE
 	void plotPictures();
 	void picturesRemoved(dive *d, QVector<QString> filenames);
@@ -145,6 +147,7 @@ private:
 	const struct dive *d;
 	int dc;
 	bool empty; // No dive shown.
+	bool pendingPlot; // The plot info of the dive is calculated in the background.
 	bool panning; // Currently panning.
 	double panningOriginalMousePosition;
 	double panningOriginalProfilePosition;
@@ -15,6 +15,8 @@
 
 PictureEntry::PictureEntry(dive *dIn, const picture &p) : d(dIn),
 	filename(p.filename),
+	image(Thumbnailer::instance()->placeholderThumbnail()),
+	thumbnailPending(true),
 	offsetSeconds(p.offset.seconds)
 {
 }
@@ -66,11 +68,25 @@ void DivePictureModel::updateZoom()
 	size = Thumbnailer::thumbnailSize(zoomLevel);
 }
 
+// The thumbnails are fetched once they are shown, see setVisibleRows().
 void DivePictureModel::updateThumbnails()
 {
 	updateZoom();
-	for (PictureEntry &entry: pictures)
-		entry.image = Thumbnailer::instance()->fetchThumbnail(QString::fromStdString(entry.filename), false);
+	QImage placeholder = Thumbnailer::instance()->placeholderThumbnail();
+	for (PictureEntry &entry: pictures) {
+		entry.image = placeholder;
+		entry.thumbnailPending = true;
+	}
+}
+
+void DivePictureModel::setVisibleRows(int first, int last)
+{
+	QVector<QString> filenames;
+	for (int i = std::max(first, 0); i <= last && i < (int)pictures.size(); ++i) {
+		if (pictures[i].thumbnailPending)
+			filenames.push_back(QString::fromStdString(pictures[i].filename));
+	}
+	Thumbnailer::instance()->setVisibleThumbnails(filenames);
 }
 
 void DivePictureModel::updateDivePictures()
@@ -218,9 +234,7 @@ void DivePictureModel::picturesAdded(dive *d, QVector<picture> picsIn)
 		int batch_size = to - from;
 		beginInsertRows(QModelIndex(), dest, dest + batch_size - 1);
 		pictures.insert(pictures.begin() + dest, from, to);
-		// Get thumbnails of inserted pictures
-		for (auto it = pictures.begin() + dest; it < pictures.begin() + dest + batch_size; ++it)
-			it->image = Thumbnailer::instance()->fetchThumbnail(QString::fromStdString(it->filename), false);
+		// The thumbnails of the inserted pictures are fetched once they are shown.
 		endInsertRows();
 		from = to;
 		dest += batch_size;
@@ -274,6 +288,7 @@ void DivePictureModel::updateThumbnail(QString filename, QImage thumbnail, durat
 			pictures[i].length = duration;
 		}
 		pictures[i].image = std::move(thumbnail);
+		pictures[i].thumbnailPending = false;
 		emit dataChanged(createIndex(i, 0), createIndex(i, 1));
 	}
 }
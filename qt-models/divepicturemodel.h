@@ -14,6 +14,7 @@ struct PictureEntry {
 	dive *d;
 	std::string filename;
 	QImage image;
+	bool thumbnailPending; // Placeholder shown, thumbnail not yet received
 	int offsetSeconds;
 	duration_t length;
 	PictureEntry(dive *, const picture &);
@@ -29,6 +30,7 @@ public:
 	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
 	void updateDivePictures();
 	void removePictures(const QModelIndexList &);
+	void setVisibleRows(int first, int last); // Fetch the thumbnails of these rows first
 public slots:
 	void setZoomLevel(int level);
 	void updateThumbnail(QString filename, QImage thumbnail, duration_t duration);
@@ -26,6 +26,8 @@
 #include <QApplication>
 #include <QTextDocument>
 #include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
 
 #define VARIATIONS_IN_BACKGROUND 1
 
@@ -243,12 +245,6 @@ void DivePlannerPointsModel::addCylinder_clicked()
 void DivePlannerPointsModel::setPlanMode(Mode m)
 {
 	mode = m;
-	// the planner may reset our GF settings that are used to show deco
-	// reset them to what's in the preferences
-	if (m != PLAN) {
-		set_gf(prefs.gflow, prefs.gfhigh);
-		set_vpmb_conservatism(prefs.vpmb_conservatism);
-	}
 }
 
 bool DivePlannerPointsModel::isPlanner() const
@@ -714,6 +710,30 @@ void DivePlannerPointsModel::setDisplayVariations(bool value)
 	emitDataChanged();
 }
 
+void DivePlannerPointsModel::setVariationsDepthSteps(int steps)
+{
+	qPrefDivePlanner::set_variations_depth_steps(steps);
+	emitDataChanged();
+}
+
+void DivePlannerPointsModel::setVariationsTimeSteps(int steps)
+{
+	qPrefDivePlanner::set_variations_time_steps(steps);
+	emitDataChanged();
+}
+
+void DivePlannerPointsModel::setVariationsGfSteps(int steps)
+{
+	qPrefDivePlanner::set_variations_gf_steps(steps);
+	emitDataChanged();
+}
+
+void DivePlannerPointsModel::setVariationsTable(bool value)
+{
+	qPrefDivePlanner::set_variations_table(value);
+	emitDataChanged();
+}
+
 void DivePlannerPointsModel::setDecoMode(int mode)
 {
 	qPrefDivePlanner::set_planner_deco_mode(deco_mode(mode));
@@ -1122,13 +1142,12 @@ void DivePlannerPointsModel::updateDiveProfile()
 	struct deco_state plan_deco_state;
 
 	plan(&plan_deco_state, diveplan, d, dcNr, decotimestep, cache, isPlanner(), false);
+	// The profile takes the gradient factors of the plan from this state
+	final_deco_state = plan_deco_state;
 	updateMaxDepth();
 
 	if (isPlanner() && shouldComputeVariations()) {
-		auto plan_copy = std::make_unique<struct diveplan>();
-		lock_planner();
-		*plan_copy = diveplan;
-		unlock_planner();
+		auto plan_copy = std::make_unique<struct diveplan>(diveplan);
 #ifdef VARIATIONS_IN_BACKGROUND
 		// Since we're calling computeVariations asynchronously and plan_deco_state is allocated
 		// on the stack, it must be copied and freed by the worker-thread.
@@ -1151,7 +1170,6 @@ void DivePlannerPointsModel::updateDiveProfile()
 #else
 		computeVariations(std::move(plan_copy), &plan_deco_state);
 #endif
-		final_deco_state = plan_deco_state;
 	}
 	emit calculatedPlanNotes(QString::fromStdString(d->notes));
 
@@ -1176,22 +1194,17 @@ void DivePlannerPointsModel::saveDuplicatePlan()
 	createPlan(true);
 }
 
-int DivePlannerPointsModel::analyzeVariations(const std::vector<decostop> &min, const std::vector<decostop> &mid, const std::vector<decostop> &max, const char *unit)
+// Average change of the total stop time per step, given the totals at -steps and +steps.
+int DivePlannerPointsModel::analyzeVariations(int min, int max, int steps, const char *unit)
 {
-	auto sum_time = [](int time, const decostop &ds) { return ds.time + time; };
-	int minsum = std::accumulate(min.begin(), min.end(), 0, sum_time);
-	int midsum = std::accumulate(mid.begin(), mid.end(), 0, sum_time);
-	int maxsum = std::accumulate(max.begin(), max.end(), 0, sum_time);
-	int leftsum = midsum - minsum;
-	int rightsum = maxsum - midsum;
+	int delta = (max - min) / (2 * steps);
 
 #ifdef DEBUG_STOPVAR
-	printf("Total + %d:%02d/%s +- %d s/%s\n\n", FRACTION_TUPLE((leftsum + rightsum) / 2, 60), unit,
-						       (rightsum - leftsum) / 2, unit);
+	printf("Total + %d:%02d/%s\n\n", FRACTION_TUPLE(delta, 60), unit);
 #else
 	Q_UNUSED(unit)
 #endif
-	return (leftsum + rightsum) / 2;
+	return delta;
 }
 
 void DivePlannerPointsModel::computeVariationsFreeDeco(std::unique_ptr<struct diveplan> original_plan, std::unique_ptr<struct deco_state> previous_ds)
@@ -1208,20 +1221,79 @@ auto &second_to_last(T &v)
 	return *std::prev(std::prev(v.end()));
 }
 
+namespace {
+	struct plan_variation {
+		int depth_step, time_step, gf_step;
+		int stoptime = 0; // total time of all stops of the varied plan
+	};
+
+	// Each axis is varied by +/- n steps, where a step is one depth unit of the
+	// last segment, one minute of bottom time or five percentage points of both
+	// gradient factors. By default, only one parameter is varied at a time.
+	// For a contingency table, all combinations are computed and listed in
+	// the planner notes.
+	struct variation_grid_size {
+		int depthSteps, timeSteps, gfSteps;
+		bool contingencyTable;
+	};
+}
+
+static constexpr int gf_variation_step = 5; // percentage points
+
+static variation_grid_size variation_grid_from_prefs()
+{
+	return { std::max(prefs.variations_depth_steps, 1),
+		 std::max(prefs.variations_time_steps, 1),
+		 std::max(prefs.variations_gf_steps, 0),
+		 prefs.variations_table };
+}
+
+static std::vector<plan_variation> variation_grid(const variation_grid_size &grid)
+{
+	std::vector<plan_variation> res;
+	if (grid.contingencyTable) {
+		for (int depth = -grid.depthSteps; depth <= grid.depthSteps; depth++) {
+			for (int time = -grid.timeSteps; time <= grid.timeSteps; time++) {
+				for (int gf = -grid.gfSteps; gf <= grid.gfSteps; gf++)
+					res.push_back({ depth, time, gf });
+			}
+		}
+		return res;
+	}
+
+	// Only vary one parameter at a time. The unvaried plan isn't needed.
+	for (int step = 1; step <= grid.depthSteps; step++) {
+		res.push_back({ -step, 0, 0 });
+		res.push_back({ step, 0, 0 });
+	}
+	for (int step = 1; step <= grid.timeSteps; step++) {
+		res.push_back({ 0, -step, 0 });
+		res.push_back({ 0, step, 0 });
+	}
+	for (int step = 1; step <= grid.gfSteps; step++) {
+		res.push_back({ 0, 0, -step });
+		res.push_back({ 0, 0, step });
+	}
+	return res;
+}
+
+static int variation_stoptime(const std::vector<plan_variation> &variations, int depth_step, int time_step, int gf_step)
+{
+	auto it = std::find_if(variations.begin(), variations.end(), [=](const plan_variation &v)
+			       { return v.depth_step == depth_step && v.time_step == time_step && v.gf_step == gf_step; });
+	return it != variations.end() ? it->stoptime : 0;
+}
+
 void DivePlannerPointsModel::computeVariations(std::unique_ptr<struct diveplan> original_plan, const struct deco_state *previous_ds)
 {
 	// nothing to do unless there's an original plan
-	if (!original_plan)
+	if (!original_plan || original_plan->dp.size() < 2)
 		return;
 
 	auto dive = std::make_unique<struct dive>();
 	copy_dive(d, dive.get());
-	deco_state_cache cache, save;
-	struct diveplan plan_copy;
-	struct deco_state ds = *previous_ds;
-
 	int my_instance = ++instanceCounter;
-	save.cache(&ds);
+	variation_grid_size grid = variation_grid_from_prefs();
 
 	duration_t delta_time = 1_min;
 	QString time_units = tr("min");
@@ -1236,45 +1308,57 @@ void DivePlannerPointsModel::computeVariations(std::unique_ptr<struct diveplan>
 		depth_units = tr("ft");
 	}
 
-	plan_copy = *original_plan;
-	if (plan_copy.dp.size() < 2)
-		return;
-	if (my_instance != instanceCounter)
-		return;
-	auto original = plan(&ds, plan_copy, dive.get(), dcNr, 1, cache, true, false);
-	save.restore(&ds, false);
-
-	plan_copy = *original_plan;
-	second_to_last(plan_copy.dp).depth.mm += delta_depth.mm;
-	plan_copy.dp.back().depth.mm += delta_depth.mm;
-	if (my_instance != instanceCounter)
-		return;
-	auto deeper = plan(&ds, plan_copy, dive.get(), dcNr, 1, cache, true, false);
-	save.restore(&ds, false);
-
-	second_to_last(plan_copy.dp).depth.mm -= delta_depth.mm;
-	plan_copy.dp.back().depth.mm -= delta_depth.mm;
-	if (my_instance != instanceCounter)
-		return;
-	auto shallower = plan(&ds, plan_copy, dive.get(), dcNr, 1, cache, true, false);
-	save.restore(&ds, false);
-
-	plan_copy = *original_plan;
-	plan_copy.dp.back().time += delta_time.seconds;
-	if (my_instance != instanceCounter)
-		return;
-	auto longer = plan(&ds, plan_copy, dive.get(), dcNr, 1, cache, true, false);
-	save.restore(&ds, false);
-
-	plan_copy.dp.back().time -= delta_time.seconds;
+	// Each variation is planned on its own copies of the plan, the dive and the
+	// deco state, so that they can be distributed over the thread pool.
+	std::vector<plan_variation> variations = variation_grid(grid);
+	QtConcurrent::blockingMap(variations, [&](plan_variation &v) {
+		if (my_instance != instanceCounter)
+			return;
+		struct diveplan plan_copy = *original_plan;
+		second_to_last(plan_copy.dp).depth.mm += v.depth_step * delta_depth.mm;
+		plan_copy.dp.back().depth.mm += v.depth_step * delta_depth.mm;
+		plan_copy.dp.back().time += v.time_step * delta_time.seconds;
+		plan_copy.gflow = std::clamp(plan_copy.gflow + v.gf_step * gf_variation_step, 1, 100);
+		plan_copy.gfhigh = std::clamp(plan_copy.gfhigh + v.gf_step * gf_variation_step, 1, 100);
+
+		struct dive variation_dive;
+		copy_dive(dive.get(), &variation_dive);
+		struct deco_state ds = *previous_ds;
+		deco_state_cache cache;
+		auto stops = plan(&ds, plan_copy, &variation_dive, dcNr, 1, cache, true, false);
+		v.stoptime = std::accumulate(stops.begin(), stops.end(), 0,
+					     [](int time, const decostop &ds) { return ds.time + time; });
+	});
 	if (my_instance != instanceCounter)
 		return;
-	auto shorter = plan(&ds, plan_copy, dive.get(), dcNr, 1, cache, true, false);
-	save.restore(&ds, false);
 
 	std::string buf = format_string_std(", %s: %c %d:%02d /%s %c %d:%02d /min", qPrintable(tr("Stop times")),
-		SIGNED_FRAC_TRIPLET(analyzeVariations(shallower, original, deeper, qPrintable(depth_units)), 60), qPrintable(depth_units),
-		SIGNED_FRAC_TRIPLET(analyzeVariations(shorter, original, longer, qPrintable(time_units)), 60));
+		SIGNED_FRAC_TRIPLET(analyzeVariations(variation_stoptime(variations, -grid.depthSteps, 0, 0),
+						      variation_stoptime(variations, grid.depthSteps, 0, 0),
+						      grid.depthSteps, qPrintable(depth_units)), 60), qPrintable(depth_units),
+		SIGNED_FRAC_TRIPLET(analyzeVariations(variation_stoptime(variations, 0, -grid.timeSteps, 0),
+						      variation_stoptime(variations, 0, grid.timeSteps, 0),
+						      grid.timeSteps, qPrintable(time_units)), 60));
+	if (grid.gfSteps > 0) {
+		// More conservative means lower gradient factors, therefore count the change towards lower values.
+		buf += format_string_std(" %c %d:%02d /-%d%% %s",
+			SIGNED_FRAC_TRIPLET(analyzeVariations(variation_stoptime(variations, 0, 0, grid.gfSteps),
+							      variation_stoptime(variations, 0, 0, -grid.gfSteps),
+							      grid.gfSteps, "GF"), 60),
+			gf_variation_step, qPrintable(tr("GF")));
+	}
+	if (grid.contingencyTable) {
+		buf += format_string_std("<br/>\n<table>\n<tr><th>%s</th><th style='padding-left: 10px;'>%s</th><th style='padding-left: 10px;'>%s</th><th style='padding-left: 10px;'>%s</th></tr>\n",
+			qPrintable(tr("depth")), qPrintable(tr("bottom time")), qPrintable(tr("GF")), qPrintable(tr("stop time")));
+		for (const plan_variation &v: variations) {
+			buf += format_string_std("<tr><td>%+d %s</td><td style='padding-left: 10px;'>%+d %s</td><td style='padding-left: 10px;'>%d/%d</td><td style='padding-left: 10px;'>%d:%02d</td></tr>\n",
+				v.depth_step, qPrintable(depth_units), v.time_step, qPrintable(time_units),
+				std::clamp(original_plan->gflow + v.gf_step * gf_variation_step, 1, 100),
+				std::clamp(original_plan->gfhigh + v.gf_step * gf_variation_step, 1, 100),
+				FRACTION_TUPLE(v.stoptime, 60));
+		}
+		buf += "</table>";
+	}
 
 	// By using a signal, we can transport the variations to the main thread.
 	emit variationsComputed(QString::fromStdString(buf));
@@ -1311,10 +1395,7 @@ void DivePlannerPointsModel::createPlan(bool saveAsNew)
 	plan(&ds_after_previous_dives, diveplan, d, dcNr, decotimestep, cache, isPlanner(), true);
 
 	if (shouldComputeVariations()) {
-		auto plan_copy = std::make_unique<struct diveplan>();
-		lock_planner();
-		*plan_copy = diveplan;
-		unlock_planner();
+		auto plan_copy = std::make_unique<struct diveplan>(diveplan);
 		computeVariations(std::move(plan_copy), &ds_after_previous_dives);
 	}
 
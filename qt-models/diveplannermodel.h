@@ -4,6 +4,7 @@
 
 #include <QAbstractTableModel>
 #include <QDateTime>
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -87,6 +88,10 @@ slots:
 	void setDisplayDuration(bool value);
 	void setDisplayTransitions(bool value);
 	void setDisplayVariations(bool value);
+	void setVariationsDepthSteps(int steps);
+	void setVariationsTimeSteps(int steps);
+	void setVariationsGfSteps(int steps);
+	void setVariationsTable(bool value);
 	void setDecoMode(int mode);
 	void setSafetyStop(bool value);
 	void savePlan();
@@ -133,14 +138,14 @@ private:
 	void computeVariationsDone(QString text);
 	void computeVariations(std::unique_ptr<struct diveplan> plan, const struct deco_state *ds);
 	void computeVariationsFreeDeco(std::unique_ptr<struct diveplan> plan, std::unique_ptr<struct deco_state> ds);
-	int analyzeVariations(const std::vector<decostop> &min, const std::vector<decostop> &mid, const std::vector<decostop> &max, const char *unit);
+	int analyzeVariations(int min, int max, int steps, const char *unit);
 	struct dive *d;
 	int dcNr;
 	CylindersModel cylinders;
 	Mode mode;
 	QVector<divedatapoint> divepoints;
 	QDateTime startTime;
-	int instanceCounter = 0;
+	std::atomic<int> instanceCounter = 0;
 	struct deco_state ds_after_previous_dives;
 	duration_t preserved_until;
 };
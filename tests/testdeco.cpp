@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testdeco.h"
+#include "core/deco.h"
+#include "core/dive.h"
+#include "core/pref.h"
+
+#include <string.h>
+#include <vector>
+
+// The vectorized per-tissue kernels must produce exactly the same results
+// as the scalar ones. Run the same pseudo-random sequence of segments through
+// both and compare all the tissue data bit for bit.
+
+struct deco_run {
+	struct deco_state ds;
+	std::vector<double> tolerance;
+	std::vector<int> guiding_tissue;
+	std::vector<bool> icd_warning;
+};
+
+static deco_run run_segments(bool vectorized, bool in_planner)
+{
+	deco_run res;
+	struct dive dive;
+	set_vectorized_deco(vectorized);
+	clear_deco(&res.ds, 1.013, in_planner);
+
+	// Simple linear congruential generator, so that both runs see the same sequence
+	unsigned int seed = 12345;
+	auto next = [&seed](unsigned int max) {
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) % max;
+	};
+
+	for (int i = 0; i < 2000; i++) {
+		double pressure = 1.013 + next(10000) / 1000.0;
+		struct gasmix gasmix = { { .permille = 100 + (int)next(400) }, { .permille = (int)next(500) } };
+		int period = 1 + next(120);
+		add_segment(&res.ds, pressure, gasmix, period, 0, OC, prefs.bottomsac, in_planner);
+		res.tolerance.push_back(tissue_tolerance_calc(&res.ds, &dive, pressure, in_planner));
+		res.guiding_tissue.push_back(res.ds.ci_pointing_to_guiding_tissue);
+		res.icd_warning.push_back(res.ds.icd_warning);
+	}
+	return res;
+}
+
+static bool same_tissues(const double (&t1)[16], const double (&t2)[16])
+{
+	return memcmp(t1, t2, sizeof(t1)) == 0;
+}
+
+static void compare_runs(const deco_run &scalar, const deco_run &vectorized)
+{
+	QVERIFY(scalar.tolerance == vectorized.tolerance);
+	QVERIFY(scalar.guiding_tissue == vectorized.guiding_tissue);
+	QVERIFY(scalar.icd_warning == vectorized.icd_warning);
+	QVERIFY(same_tissues(scalar.ds.tissue_n2_sat, vectorized.ds.tissue_n2_sat));
+	QVERIFY(same_tissues(scalar.ds.tissue_he_sat, vectorized.ds.tissue_he_sat));
+	QVERIFY(same_tissues(scalar.ds.tissue_inertgas_saturation, vectorized.ds.tissue_inertgas_saturation));
+	QVERIFY(same_tissues(scalar.ds.tolerated_by_tissue, vectorized.ds.tolerated_by_tissue));
+	QVERIFY(same_tissues(scalar.ds.buehlmann_inertgas_a, vectorized.ds.buehlmann_inertgas_a));
+	QVERIFY(same_tissues(scalar.ds.buehlmann_inertgas_b, vectorized.ds.buehlmann_inertgas_b));
+	QCOMPARE(scalar.ds.gf_low_pressure_this_dive, vectorized.ds.gf_low_pressure_this_dive);
+}
+
+void TestDeco::init()
+{
+	prefs = default_prefs;
+	set_gf(30, 75);
+}
+
+void TestDeco::cleanup()
+{
+	set_vectorized_deco(true);
+}
+
+void TestDeco::testVectorizedBuehlmann()
+{
+	prefs.planner_deco_mode = BUEHLMANN;
+	compare_runs(run_segments(false, true), run_segments(true, true));
+}
+
+void TestDeco::testVectorizedVpmb()
+{
+	prefs.planner_deco_mode = VPMB;
+	compare_runs(run_segments(false, true), run_segments(true, true));
+}
+
+// Changing the settings of one deco state must neither touch the defaults
+// nor other deco states, and clearing the state must keep its settings.
+void TestDeco::testSettingsPerState()
+{
+	struct deco_state ds1, ds2;
+	ds1.settings.set_gf(50, 90);
+	ds1.settings.set_vpmb_conservatism(7);
+	clear_deco(&ds1, 1.013, true);
+	QCOMPARE(ds1.settings.gf_low, 0.5);
+	QCOMPARE(ds1.settings.gf_high, 0.9);
+	QCOMPARE(ds1.settings.vpmb_conservatism, (short)4);
+	QCOMPARE(ds2.settings.gf_low, 0.3);
+	QCOMPARE(ds2.settings.gf_high, 0.75);
+	QCOMPARE(default_deco_settings().gf_low, 0.3);
+
+	// Stricter gradient factors give a deeper ceiling for the same tissue loading
+	struct dive dive;
+	clear_deco(&ds2, 1.013, true);
+	struct gasmix air = { { .permille = 209 }, { .permille = 0 } };
+	add_segment(&ds1, 5.0, air, 40 * 60, 0, OC, prefs.bottomsac, true);
+	add_segment(&ds2, 5.0, air, 40 * 60, 0, OC, prefs.bottomsac, true);
+	QVERIFY(tissue_tolerance_calc(&ds2, &dive, 1.013, true) > tissue_tolerance_calc(&ds1, &dive, 1.013, true));
+}
+
+QTEST_GUILESS_MAIN(TestDeco)
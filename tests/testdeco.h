@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTDECO_H
+#define TESTDECO_H
+
+#include <QtTest>
+
+class TestDeco : public QObject {
+	Q_OBJECT
+private slots:
+	void init();
+	void cleanup();
+	void testVectorizedBuehlmann();
+	void testVectorizedVpmb();
+	void testSettingsPerState();
+};
+
+#endif
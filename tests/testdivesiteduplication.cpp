@@ -4,6 +4,9 @@
 #include "core/divesite.h"
 #include "core/file.h"
 #include "core/pref.h"
+#include "core/units.h"
+
+#include <random>
 
 void TestDiveSiteDuplication::testReadV2()
 {
@@ -12,4 +15,47 @@ void TestDiveSiteDuplication::testReadV2()
 	QCOMPARE(divelog.sites.size(), 2);
 }
 
+// Compare the indexed lookups against a linear search over all sites
+static dive_site *nearest_site(const dive_site_table &sites, location_t loc, int distance)
+{
+	dive_site *res = nullptr;
+	unsigned int min_distance = distance;
+	for (const auto &ds: sites) {
+		if (!ds->has_gps_location())
+			continue;
+		unsigned int d = get_distance(ds->location, loc);
+		if (d < min_distance || (res && d == min_distance && ds->uuid < res->uuid)) {
+			res = ds.get();
+			min_distance = d;
+		}
+	}
+	return res;
+}
+
+void TestDiveSiteDuplication::testGpsLookup()
+{
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<double> lat(-89.9, 89.9), lon(-180.0, 180.0), offset(-0.05, 0.05);
+	dive_site_table sites;
+	for (int i = 0; i < 2000; ++i)
+		sites.create("site", create_location(lat(gen), lon(gen)));
+
+	// Move some sites around, including across the antimeridian
+	for (int i = 0; i < 200; ++i) {
+		dive_site *ds = sites[i].get();
+		ds->location = create_location(lat(gen), i % 2 ? 179.99 : -179.99);
+		sites.location_changed(ds);
+	}
+	sites.pull(sites[500].get());
+
+	for (int i = 0; i < 500; ++i) {
+		const dive_site &ds = *sites[i * 3];
+		location_t loc = create_location(ds.location.lat.udeg / 1000000.0 + offset(gen),
+						 ds.location.lon.udeg / 1000000.0 + offset(gen));
+		for (int distance: { 100, 5000, 50000 })
+			QCOMPARE(sites.get_by_gps_proximity(loc, distance), nearest_site(sites, loc, distance));
+		QCOMPARE(sites.get_by_gps(&ds.location), &ds);
+	}
+}
+
 QTEST_GUILESS_MAIN(TestDiveSiteDuplication)
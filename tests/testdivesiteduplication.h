@@ -8,6 +8,7 @@ class TestDiveSiteDuplication : public QObject {
 	Q_OBJECT
 private slots:
 	void testReadV2();
+	void testGpsLookup();
 };
 
 #endif // TESTDIVESITEDUPLICATION_H
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testfulltext.h"
+#include "core/dive.h"
+#include "core/divelog.h"
+#include "core/divesite.h"
+#include "core/filterconstraint.h"
+#include "core/filterconstraintcache.h"
+#include "core/fulltext.h"
+#include "core/trip.h"
+#include "core/subsurface-qt/divelistnotifier.h"
+
+static std::vector<std::unique_ptr<dive>> dives;
+
+static dive *add_dive(const char *notes)
+{
+	dives.push_back(std::make_unique<dive>());
+	dives.back()->notes = notes;
+	fulltext_register(dives.back().get());
+	return dives.back().get();
+}
+
+static std::vector<dive *> find(const char *query, StringFilterMode mode)
+{
+	FullTextQuery q;
+	q = QString(query);
+	FullTextResult ft = fulltext_find_dives(q, mode);
+	std::vector<dive *> res;
+	for (auto &d: dives) {
+		if (ft.dive_matches(d.get()))
+			res.push_back(d.get());
+	}
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+// Search all dives one by one, which doesn't use the index
+static std::vector<dive *> find_slow(const char *query, StringFilterMode mode)
+{
+	FullTextQuery q;
+	q = QString(query);
+	std::vector<dive *> res;
+	for (auto &d: dives) {
+		if (fulltext_dive_matches(d.get(), q, mode))
+			res.push_back(d.get());
+	}
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+void TestFullText::cleanup()
+{
+	for (auto &d: dives)
+		fulltext_unregister(d.get());
+	dives.clear();
+}
+
+void TestFullText::testSubstring()
+{
+	add_dive("Nice wreck dive, saw a barracuda");
+	dive *d2 = add_dive("Barracudas everywhere");
+	dive *d3 = add_dive("Wall dive, no wrecks");
+
+	QCOMPARE(find("racud", StringFilterMode::SUBSTRING).size(), (size_t)2);
+	QCOMPARE(find("barracudas", StringFilterMode::SUBSTRING), std::vector<dive *>{ d2 });
+	QCOMPARE(find("ec", StringFilterMode::SUBSTRING).size(), (size_t)2);
+	QVERIFY(find("xyz", StringFilterMode::SUBSTRING).empty());
+	// trigrams of the query must be found in the same word
+	QVERIFY(find("ivesaw", StringFilterMode::SUBSTRING).empty());
+	QCOMPARE(find("reck", StringFilterMode::STARTSWITH), std::vector<dive *>{});
+	QCOMPARE(find("wall", StringFilterMode::EXACT), std::vector<dive *>{ d3 });
+
+	for (const char *query: { "ive", "wre", "RACUDA", "a", "rr", "wrecks" }) {
+		QCOMPARE(find(query, StringFilterMode::SUBSTRING), find_slow(query, StringFilterMode::SUBSTRING));
+		QCOMPARE(find(query, StringFilterMode::STARTSWITH), find_slow(query, StringFilterMode::STARTSWITH));
+	}
+}
+
+void TestFullText::testUnregister()
+{
+	dive *d1 = add_dive("Lots of nudibranchs");
+	dive *d2 = add_dive("One nudibranch");
+
+	QCOMPARE(find("dibra", StringFilterMode::SUBSTRING).size(), (size_t)2);
+
+	fulltext_unregister(d1);
+	QCOMPARE(find("dibra", StringFilterMode::SUBSTRING), std::vector<dive *>{ d2 });
+	QCOMPARE(find("branchs", StringFilterMode::SUBSTRING), std::vector<dive *>{});
+
+	// registering again after a change replaces the old words
+	d2->notes = "Seahorse";
+	fulltext_register(d2);
+	QVERIFY(find("dibra", StringFilterMode::SUBSTRING).empty());
+	QCOMPARE(find("horse", StringFilterMode::SUBSTRING), std::vector<dive *>{ d2 });
+
+	// the index of an unregistered dive is reused
+	dive *d3 = add_dive("Frogfish");
+	QCOMPARE(find("frog", StringFilterMode::STARTSWITH), std::vector<dive *>{ d3 });
+	QVERIFY(find("nudibranchs", StringFilterMode::EXACT).empty());
+}
+
+void TestFullText::testMultipleWords()
+{
+	dive *d1 = add_dive("Shark and turtle");
+	add_dive("Turtle");
+	add_dive("Shark");
+
+	QCOMPARE(find("turtle shark", StringFilterMode::EXACT), std::vector<dive *>{ d1 });
+	QCOMPARE(find("tur", StringFilterMode::STARTSWITH).size(), (size_t)2);
+	QCOMPARE(find("urtl ark", StringFilterMode::SUBSTRING), std::vector<dive *>{ d1 });
+	QVERIFY(find("turtle whale", StringFilterMode::EXACT).empty());
+}
+
+void TestFullText::testFilterStrings()
+{
+	// string constraints use the strings cached at registration
+	dive *d = add_dive("Night dive");
+	d->buddy = "Anna, Bob";
+	fulltext_register(d);
+	auto unregistered = std::make_unique<dive>(*d);
+
+	filter_constraint people(FILTER_CONSTRAINT_PEOPLE);
+	people.string_mode = FILTER_CONSTRAINT_EXACT;
+	filter_constraint_set_stringlist(people, "bob");
+	filter_constraint notes(FILTER_CONSTRAINT_NOTES);
+	notes.string_mode = FILTER_CONSTRAINT_SUBSTRING;
+	filter_constraint_set_stringlist(notes, "GHT D");
+
+	QVERIFY(d->full_text && !unregistered->full_text);
+	QVERIFY(filter_constraint_match_dive(people, d));
+	QVERIFY(filter_constraint_match_dive(people, unregistered.get()));
+	QVERIFY(filter_constraint_match_dive(notes, d));
+	QVERIFY(filter_constraint_match_dive(notes, unregistered.get()));
+
+	d->buddy = "Carl";
+	fulltext_register(d);
+	QVERIFY(!filter_constraint_match_dive(people, d));
+}
+
+void TestFullText::testConstraintCache()
+{
+	// renaming a dive site doesn't edit the dives, but must still update the cached matches
+	divelog.clear();
+	dive_site *ds = divelog.sites.create("Blue Hole");
+	dive *d1 = divelog.dives.put(std::make_unique<dive>()).ptr;
+	auto d2 = std::make_unique<dive>();
+	d2->when = 3600;
+	divelog.dives.put(std::move(d2));
+	ds->add_dive(d1);
+	size_t idx = divelog.dives.get_idx(d1);
+
+	filter_constraint location(FILTER_CONSTRAINT_LOCATION);
+	location.string_mode = FILTER_CONSTRAINT_SUBSTRING;
+	filter_constraint_set_stringlist(location, "hole");
+	FilterConstraintCache cache;
+	std::vector<uint64_t> matches = cache.matches({ location });
+	QVERIFY(FilterConstraintCache::testBit(matches, idx));
+	QVERIFY(!FilterConstraintCache::testBit(matches, 1 - idx));
+
+	ds->name = "Reef";
+	emit diveListNotifier.diveSiteChanged(ds, 0);
+	matches = cache.matches({ location });
+	QVERIFY(!FilterConstraintCache::testBit(matches, idx));
+
+	// moving a dive to another trip changes its location
+	dive_trip redSea, caribbean;
+	redSea.location = "Red Sea";
+	caribbean.location = "Blue Hole, Belize";
+	redSea.add_dive(d1);
+	matches = cache.matches({ location });
+	QVERIFY(!FilterConstraintCache::testBit(matches, idx));
+	unregister_dive_from_trip(d1);
+	caribbean.add_dive(d1);
+	emit diveListNotifier.divesMovedBetweenTrips(&redSea, &caribbean, false, false, { d1 });
+	matches = cache.matches({ location });
+	QVERIFY(FilterConstraintCache::testBit(matches, idx));
+
+	// editing a weight system while another constraint is active
+	filter_constraint weightType(FILTER_CONSTRAINT_WEIGHT_TYPE);
+	weightType.string_mode = FILTER_CONSTRAINT_SUBSTRING;
+	filter_constraint_set_stringlist(weightType, "belt");
+	d1->weightsystems.add(0, weightsystem_t(weight_t{ .grams = 2000 }, "ankle", false));
+	emit diveListNotifier.weightAdded(d1, 0);
+	matches = cache.matches({ location, weightType });
+	QVERIFY(!FilterConstraintCache::testBit(matches, idx));
+	d1->weightsystems.set(0, weightsystem_t(weight_t{ .grams = 2000 }, "belt", false));
+	emit diveListNotifier.weightEdited(d1, 0);
+	matches = cache.matches({ location, weightType });
+	QVERIFY(FilterConstraintCache::testBit(matches, idx));
+
+	unregister_dive_from_trip(d1);
+	divelog.clear();
+}
+
+void TestFullText::benchmarkFilterStrings()
+{
+	// a synthetic log, to compare the cached strings to converting on the fly
+	for (int i = 0; i < 20000; ++i) {
+		dive *d = add_dive(qPrintable(QStringLiteral("Dive %1 with a longer note about the reef").arg(i)));
+		d->buddy = i % 2 ? "Anna, Bob" : "Carl";
+		d->suit = "Drysuit";
+	}
+	filter_constraint people(FILTER_CONSTRAINT_PEOPLE);
+	filter_constraint_set_stringlist(people, "bo");
+	filter_constraint notes(FILTER_CONSTRAINT_NOTES);
+	notes.string_mode = FILTER_CONSTRAINT_SUBSTRING;
+	filter_constraint_set_stringlist(notes, "REEF");
+
+	int matches = 0;
+	QBENCHMARK {
+		matches = 0;
+		for (auto &d: dives)
+			matches += filter_constraint_match_dive(people, d.get()) && filter_constraint_match_dive(notes, d.get());
+	}
+	QCOMPARE(matches, 10000);
+}
+
+QTEST_GUILESS_MAIN(TestFullText)
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTFULLTEXT_H
+#define TESTFULLTEXT_H
+
+#include <QtTest>
+
+class TestFullText : public QObject {
+	Q_OBJECT
+private slots:
+	void cleanup();
+	void testSubstring();
+	void testUnregister();
+	void testMultipleWords();
+	void testFilterStrings();
+	void testConstraintCache();
+	void benchmarkFilterStrings();
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include "core/dive.h"
 #include "core/divelist.h"
 #include "core/divelog.h"
+#include "core/divesite.h"
 #include "core/errorhelper.h"
 #include "core/file.h"
 #include "core/subsurface-string.h"
@@ -213,6 +214,183 @@ void TestGitStorage::testGitStorageLocal()
 	QCOMPARE(readin, written);
 }
 
+static std::string saved_tree_id(const std::string &dirName)
+{
+	git_repository *repo;
+	git_object *tree;
+	char hex[GIT_OID_HEXSZ + 1];
+	if (git_repository_open(&repo, dirName.c_str()))
+		return std::string();
+	if (git_revparse_single(&tree, repo, "test^{tree}")) {
+		git_repository_free(repo);
+		return std::string();
+	}
+	git_oid_tostr(hex, sizeof(hex), git_object_id(tree));
+	git_object_free(tree);
+	git_repository_free(repo);
+	return hex;
+}
+
+void TestGitStorage::testGitStorageParallelSave()
+{
+	// the dives are written in parallel, which must result in the same tree as writing them serially
+	git_repository *repo;
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &divelog), 0);
+	for (const char *dirName: { "./gittest_serial", "./gittest_parallel" }) {
+		QDir testDir(dirName);
+		QCOMPARE(testDir.removeRecursively(), true);
+		QCOMPARE(QDir().mkdir(dirName), true);
+		QCOMPARE(git_repository_init(&repo, dirName, false), 0);
+		git_repository_free(repo);
+	}
+	set_git_parallel_save(false);
+	QCOMPARE(save_dives("./gittest_serial[test]"), 0);
+	set_git_parallel_save(true);
+	QCOMPARE(save_dives("./gittest_parallel[test]"), 0);
+	std::string serial = saved_tree_id("./gittest_serial");
+	QVERIFY(!serial.empty());
+	QCOMPARE(saved_tree_id("./gittest_parallel"), serial);
+}
+
+void TestGitStorage::testGitStorageDcCache()
+{
+	// after editing a dive, the unchanged dive computer blobs are reused, which must result
+	// in the same tree as writing everything to a new repository
+	git_repository *repo;
+	for (const char *dirName: { "./gittest_dccache", "./gittest_dccache_full" }) {
+		QDir testDir(dirName);
+		QCOMPARE(testDir.removeRecursively(), true);
+		QCOMPARE(QDir().mkdir(dirName), true);
+		QCOMPARE(git_repository_init(&repo, dirName, false), 0);
+		git_repository_free(repo);
+	}
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &divelog), 0);
+	QCOMPARE(save_dives("./gittest_dccache[test]"), 0);
+	clear_dive_file_data();
+	QCOMPARE(parse_file("./gittest_dccache[test]", &divelog), 0);
+	QVERIFY(divelog.dives.size() >= 2);
+
+	// a change of the dive header only and a change of a dive computer
+	divelog.dives[0]->buddy = "Someone Else";
+	divelog.dives[0]->invalidate_cache();
+	divelog.dives[1]->dcs[0].maxdepth.mm += 1000;
+	divelog.dives[1]->invalidate_cache();
+
+	QCOMPARE(save_dives("./gittest_dccache[test]"), 0);
+	QCOMPARE(save_dives("./gittest_dccache_full[test]"), 0);
+	std::string full = saved_tree_id("./gittest_dccache_full");
+	QVERIFY(!full.empty());
+	QCOMPARE(saved_tree_id("./gittest_dccache"), full);
+}
+
+static QString readFile(const char *name)
+{
+	QFile f(name);
+	f.open(QFile::ReadOnly);
+	QTextStream s(&f);
+	return s.readAll();
+}
+
+static std::string readGitFile(const std::string &dirName, const char *spec)
+{
+	git_repository *repo;
+	git_object *blob;
+	std::string res;
+	if (git_repository_open(&repo, dirName.c_str()))
+		return res;
+	if (!git_revparse_single(&blob, repo, spec)) {
+		res.assign((const char *)git_blob_rawcontent((git_blob *)blob), git_blob_rawsize((git_blob *)blob));
+		git_object_free(blob);
+	}
+	git_repository_free(repo);
+	return res;
+}
+
+void TestGitStorage::testGitStorageParallelLoad()
+{
+	// reading the blobs and parsing the dive computers in parallel must give the same dives as loading serially
+	git_repository *repo;
+	QDir testDir("./gittest_load");
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir("./gittest_load"), true);
+	QCOMPARE(git_repository_init(&repo, "./gittest_load", false), 0);
+	git_repository_free(repo);
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &divelog), 0);
+
+	// copies of the dives at later dates, so that the loader goes through several
+	// batches of dive computers and the blob readers have to wait for the parser
+	size_t nr = divelog.dives.size();
+	QVERIFY(nr > 0);
+	for (int copy = 1; divelog.dives.size() < 1200; ++copy) {
+		for (size_t i = 0; i < nr; ++i) {
+			auto d = std::make_unique<dive>();
+			copy_dive(divelog.dives[i].get(), d.get());
+			d->id = dive_getUniqID();
+			d->when += copy * 400 * 24 * 3600;
+			d->divetrip = nullptr;
+			if (d->dive_site) {
+				dive_site *ds = d->dive_site;
+				d->dive_site = nullptr;
+				ds->add_dive(d.get());
+			}
+			divelog.dives.record_dive(std::move(d));
+		}
+	}
+	QCOMPARE(save_dives("./gittest_load[test]"), 0);
+
+	clear_dive_file_data();
+	set_git_parallel_load(false);
+	QCOMPARE(parse_file("./gittest_load[test]", &divelog), 0);
+	set_git_parallel_load(true);
+	QCOMPARE(save_dives("./SampleDivesV3viaserialload.ssrf"), 0);
+
+	clear_dive_file_data();
+	QCOMPARE(parse_file("./gittest_load[test]", &divelog), 0);
+	QCOMPARE(save_dives("./SampleDivesV3viaparallelload.ssrf"), 0);
+	QCOMPARE(readFile("./SampleDivesV3viaparallelload.ssrf"), readFile("./SampleDivesV3viaserialload.ssrf"));
+}
+
+void TestGitStorage::testGitStorageBinarySamples()
+{
+	// the binary sample format must give the same dives as the text format
+	git_repository *repo;
+	for (const char *dirName: { "./gittest_text", "./gittest_binary" }) {
+		QDir testDir(dirName);
+		QCOMPARE(testDir.removeRecursively(), true);
+		QCOMPARE(QDir().mkdir(dirName), true);
+		QCOMPARE(git_repository_init(&repo, dirName, false), 0);
+		git_repository_free(repo);
+	}
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &divelog), 0);
+	QCOMPARE(save_dives("./gittest_text[test]"), 0);
+	clear_dive_file_data();
+	QCOMPARE(parse_file("./gittest_text[test]", &divelog), 0);
+	QCOMPARE(save_dives("./SampleDivesV3viatext.ssrf"), 0);
+
+	prefs.git_binary_samples = true;
+	QCOMPARE(save_dives("./gittest_binary[test]"), 0);
+	prefs.git_binary_samples = false;
+	// older versions must warn about the binary samples
+	QCOMPARE(QString::fromStdString(readGitFile("./gittest_binary", "test:00-Subsurface")).section('\n', 0, 0),
+		 QString("version 4 binarysamples 1"));
+	QCOMPARE(QString::fromStdString(readGitFile("./gittest_text", "test:00-Subsurface")).section('\n', 0, 0),
+		 QString("version 3"));
+	clear_dive_file_data();
+	QCOMPARE(parse_file("./gittest_binary[test]", &divelog), 0);
+	QCOMPARE(save_dives("./SampleDivesV3viabinary.ssrf"), 0);
+	QCOMPARE(readFile("./SampleDivesV3viabinary.ssrf"), readFile("./SampleDivesV3viatext.ssrf"));
+
+	// saving as text again must not reuse the binary blobs and trees
+	QDir testDir("./gittest_text2");
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir("./gittest_text2"), true);
+	QCOMPARE(git_repository_init(&repo, "./gittest_text2", false), 0);
+	git_repository_free(repo);
+	QCOMPARE(save_dives("./gittest_binary[test]"), 0);
+	QCOMPARE(save_dives("./gittest_text2[test]"), 0);
+	QCOMPARE(saved_tree_id("./gittest_binary"), saved_tree_id("./gittest_text2"));
+}
+
 void TestGitStorage::testGitStorageCloud()
 {
 	// test writing and reading back from cloud storage
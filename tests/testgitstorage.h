@@ -13,6 +13,10 @@ private slots:
 
 	void testGitStorageLocal_data();
 	void testGitStorageLocal();
+	void testGitStorageParallelSave();
+	void testGitStorageDcCache();
+	void testGitStorageParallelLoad();
+	void testGitStorageBinarySamples();
 	void testGitStorageCloud();
 	void testGitStorageCloudOfflineSync();
 	void testGitStorageCloudMerge();
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testmembuffer.h"
+#include "core/membuffer.h"
+#include "core/units.h"
+
+#include <climits>
+#include <cstdarg>
+#include <cstdio>
+
+static const int values[] = {
+	0, 1, -1, 9, 10, 59, 60, 61, 99, 100, 999, 1000, -999, -1000, 3599, 3600,
+	12345, -12345, INT_MAX, INT_MIN + 1, INT_MIN
+};
+
+// Take the contents of the buffer and reset it for the next test
+static QByteArray take(membuffer &b)
+{
+	QByteArray res(b.buffer, b.len);
+	b.len = 0;
+	return res;
+}
+
+static QByteArray printf_string(const char *fmt, ...)
+{
+	char buf[128];
+	va_list args;
+
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	return QByteArray(buf);
+}
+
+void TestMembuffer::testPutInt()
+{
+	membuffer b;
+	for (int v: values) {
+		put_int(&b, " cns=", v, "%");
+		QCOMPARE(take(b), printf_string(" cns=%d%%", v));
+		put_uint(&b, "'", (unsigned)v, "'");
+		QCOMPARE(take(b), printf_string("'%u'", (unsigned)v));
+		put_uint(&b, "", (unsigned)v, "", 3);
+		QCOMPARE(take(b), printf_string("%3u", (unsigned)v));
+	}
+	put_int(&b, "", LLONG_MIN, "");
+	QCOMPARE(take(b), printf_string("%lld", LLONG_MIN));
+}
+
+void TestMembuffer::testPutMinSec()
+{
+	membuffer b;
+	for (int v: values) {
+		put_minsec(&b, " ndl='", v, " min'");
+		QCOMPARE(take(b), printf_string(" ndl='%u:%02u min'", FRACTION_TUPLE(v, 60)));
+		put_minsec(&b, "", v, "", 3);
+		QCOMPARE(take(b), printf_string("%3u:%02u", FRACTION_TUPLE(v, 60)));
+	}
+}
+
+void TestMembuffer::testPutMilli()
+{
+	membuffer b;
+	put_milli(&b, " depth='", 12345, " m'");
+	QCOMPARE(take(b), QByteArray(" depth='12.345 m'"));
+	put_milli(&b, "", 12300, "");
+	QCOMPARE(take(b), QByteArray("12.3"));
+	put_milli(&b, "", 12000, "");
+	QCOMPARE(take(b), QByteArray("12.0"));
+	put_milli(&b, "", -5, "");
+	QCOMPARE(take(b), QByteArray("-0.005"));
+	put_milli(&b, "", 0, "");
+	QCOMPARE(take(b), QByteArray("0.0"));
+	put_milli(&b, "", INT_MIN + 1, "");
+	QCOMPARE(take(b), QByteArray("-2147483.647"));
+}
+
+// Formatting a typical sample line, once with put_format() and once
+// with the typed formatters, for comparison.
+static const int nr_samples = 100000;
+
+void TestMembuffer::benchmarkPutFormat()
+{
+	membuffer b;
+	QBENCHMARK {
+		for (int i = 0; i < nr_samples; i++) {
+			put_format(&b, "%3u:%02u", FRACTION_TUPLE(i, 60));
+			put_format(&b, " %s%d%s", "", i % 40000, "m");
+			put_format(&b, " ndl=%u:%02u", FRACTION_TUPLE(i % 6000, 60));
+			put_format(&b, " cns=%u%%", i % 100);
+			put_format(&b, "\n");
+		}
+		b.len = 0;
+	}
+}
+
+void TestMembuffer::benchmarkTyped()
+{
+	membuffer b;
+	QBENCHMARK {
+		for (int i = 0; i < nr_samples; i++) {
+			put_minsec(&b, "", i, "", 3);
+			put_string(&b, " ");
+			put_int(&b, "", i % 40000, "m");
+			put_minsec(&b, " ndl=", i % 6000, "");
+			put_uint(&b, " cns=", i % 100, "%");
+			put_string(&b, "\n");
+		}
+		b.len = 0;
+	}
+}
+
+QTEST_GUILESS_MAIN(TestMembuffer)
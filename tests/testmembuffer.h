@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTMEMBUFFER_H
+#define TESTMEMBUFFER_H
+
+#include <QtTest>
+
+class TestMembuffer : public QObject {
+	Q_OBJECT
+private slots:
+	void testPutInt();
+	void testPutMinSec();
+	void testPutMilli();
+	void benchmarkPutFormat();
+	void benchmarkTyped();
+};
+
+#endif
@@ -266,6 +266,27 @@ void TestParse::testParseMerge()
 		     SUBSURFACE_TEST_DATA "/dives/mergedVyperOstc.xml");
 }
 
+void TestParse::testParallelSave()
+{
+	/*
+	 * the dives are rendered in parallel, which must give exactly
+	 * the same file as rendering them one after the other
+	 */
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &divelog), 0);
+	QVERIFY(!divelog.trips.empty());
+
+	set_xml_parallel_save(false);
+	QCOMPARE(save_dives("./testserial.ssrf"), 0);
+	set_xml_parallel_save(true);
+	QCOMPARE(save_dives("./testparallel.ssrf"), 0);
+
+	QFile serial("./testserial.ssrf");
+	QVERIFY(serial.open(QFile::ReadOnly));
+	QFile parallel("./testparallel.ssrf");
+	QVERIFY(parallel.open(QFile::ReadOnly));
+	QCOMPARE(parallel.readAll(), serial.readAll());
+}
+
 int TestParse::parseCSVmanual(int units, std::string file)
 {
 	verbose = 1;
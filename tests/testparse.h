@@ -24,6 +24,7 @@ private slots:
 	void testParseNewFormat();
 	void testParseDLD();
 	void testParseMerge();
+	void testParallelSave();
 
 	int parseCSVmanual(int, std::string);
 	void exportSubsurfaceCSV();
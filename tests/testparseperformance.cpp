@@ -1,12 +1,14 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "testparseperformance.h"
 #include "core/device.h"
+#include "core/dive.h"
 #include "core/divelog.h"
 #include "core/divesite.h"
 #include "core/errorhelper.h"
 #include "core/trip.h"
 #include "core/file.h"
 #include "core/git-access.h"
+#include "core/parse.h"
 #include "core/settings/qPrefProxy.h"
 #include "core/settings/qPrefCloudStorage.h"
 #include <QFile>
@@ -56,6 +58,13 @@ void TestParsePerformance::cleanup()
 	clear_dive_file_data();
 }
 
+static QByteArray readFile(const char *name)
+{
+	QFile f(name);
+	f.open(QFile::ReadOnly);
+	return f.readAll();
+}
+
 void TestParsePerformance::parseSsrf()
 {
 	// parsing of a V2 file should work
@@ -66,8 +75,34 @@ void TestParsePerformance::parseSsrf()
 		return;
 	}
 	QBENCHMARK {
+		cleanup();
+		parse_file(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf", &divelog);
+	}
+}
+
+void TestParsePerformance::parseSsrfDom()
+{
+	// same as parseSsrf(), but building the whole document tree for comparison
+	QFile largeSsrfFile(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf");
+	if (!largeSsrfFile.exists())
+		return;
+	set_xml_streaming(false);
+	parse_file(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf", &divelog);
+	QCOMPARE(save_dives("./large-anon-dom.ssrf"), 0);
+
+	cleanup();
+
+	QBENCHMARK {
+		cleanup();
 		parse_file(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf", &divelog);
 	}
+	set_xml_streaming(true);
+
+	// and both parsers have to give the same dives
+	cleanup();
+	parse_file(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf", &divelog);
+	QCOMPARE(save_dives("./large-anon-streaming.ssrf"), 0);
+	QCOMPARE(readFile("./large-anon-streaming.ssrf"), readFile("./large-anon-dom.ssrf"));
 }
 
 void TestParsePerformance::parseGit()
@@ -82,8 +117,33 @@ void TestParsePerformance::parseGit()
 	cleanup();
 
 	QBENCHMARK {
+		cleanup();
 		parse_file(LARGE_TEST_REPO "[git]", &divelog);
 	}
 }
 
+void TestParsePerformance::parseGitSerial()
+{
+	// same as parseGit(), but reading the blobs on one thread for comparison
+	git_libgit2_init();
+	set_git_parallel_load(false);
+
+	parse_file(LARGE_TEST_REPO "[git]", &divelog);
+	QCOMPARE(save_dives("./large-anon-serial.ssrf"), 0);
+
+	cleanup();
+
+	QBENCHMARK {
+		cleanup();
+		parse_file(LARGE_TEST_REPO "[git]", &divelog);
+	}
+	set_git_parallel_load(true);
+
+	// and both loaders have to give the same dives
+	cleanup();
+	parse_file(LARGE_TEST_REPO "[git]", &divelog);
+	QCOMPARE(save_dives("./large-anon-parallel.ssrf"), 0);
+	QCOMPARE(readFile("./large-anon-parallel.ssrf"), readFile("./large-anon-serial.ssrf"));
+}
+
 QTEST_GUILESS_MAIN(TestParsePerformance)
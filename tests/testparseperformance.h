@@ -12,7 +12,9 @@ private slots:
 	void cleanup();
 
 	void parseSsrf();
+	void parseSsrfDom();
 	void parseGit();
+	void parseGitSerial();
 };
 
 #endif
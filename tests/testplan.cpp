@@ -5,6 +5,7 @@
 #include "core/event.h"
 #include "core/errorhelper.h"
 #include "core/planner.h"
+#include "core/profile.h"
 #include "core/qthelper.h"
 #include "core/subsurfacestartup.h"
 #include "core/units.h"
@@ -953,4 +954,45 @@ void TestPlan::testCcrBailoutGasSelection()
 
 }
 
+static int maxCeiling(const struct plot_info &pi)
+{
+	int res = 0;
+	for (const struct plot_data &entry: pi.entry)
+		res = std::max(res, entry.ceiling);
+	return res;
+}
+
+// The planner profile must show the ceiling of the gradient factors of the plan,
+// not of the preferences.
+void TestPlan::testProfileCeilingFollowsPlanGf()
+{
+	deco_state_cache cache;
+
+	setupPrefs();
+	prefs.unit_system = METRIC;
+	prefs.units.length = units::METERS;
+	prefs.planner_deco_mode = BUEHLMANN;
+	dive.dcs[0].divemode = OC;
+	set_gf(prefs.gflow, prefs.gfhigh);
+
+	auto testPlan = setupPlan();
+	QVERIFY(testPlan.gflow != prefs.gflow);
+
+	struct deco_state plan_ds;
+	plan(&plan_ds, testPlan, &dive, 0, 60, cache, true, false);
+	QCOMPARE(plan_ds.settings.gf_low, testPlan.gflow / 100.0);
+	QCOMPARE(plan_ds.settings.gf_high, testPlan.gfhigh / 100.0);
+
+	// Same state, but with the gradient factors of the preferences.
+	struct deco_state prefs_ds = plan_ds;
+	prefs_ds.settings = default_deco_settings();
+
+	struct plot_info plan_pi = create_plot_info_new(&dive, &dive.dcs[0], &plan_ds);
+	struct plot_info prefs_pi = create_plot_info_new(&dive, &dive.dcs[0], &prefs_ds);
+
+	// The plan uses GF 100/100, which is less conservative than the default 30/75.
+	QVERIFY(maxCeiling(plan_pi) > 0);
+	QVERIFY(maxCeiling(plan_pi) < maxCeiling(prefs_pi));
+}
+
 QTEST_GUILESS_MAIN(TestPlan)
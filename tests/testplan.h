@@ -20,6 +20,7 @@ private slots:
 	void testVpmbMetricRepeat();
 	void testMultipleGases();
 	void testCcrBailoutGasSelection();
+	void testProfileCeilingFollowsPlanGf();
 };
 
 #endif // TESTPLAN_H
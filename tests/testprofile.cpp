@@ -1,13 +1,18 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "testprofile.h"
+#include "core/deco.h"
 #include "core/device.h"
 #include "core/dive.h"
+#include "core/divelist.h"
 #include "core/divelog.h"
 #include "core/divesite.h"
 #include "core/trip.h"
 #include "core/file.h"
+#include "core/plotinfocache.h"
+#include "core/profile.h"
 #include "core/save-profiledata.h"
 #include "core/pref.h"
+#include "core/subsurface-qt/divelistnotifier.h"
 #include "QTextCodec"
 
 // This test compares the content of struct profile against a known reference version for a list
@@ -64,4 +69,199 @@ void TestProfile::testProfileExportVPMB()
 
 }
 
+static void compareDecoInformation(const plot_info &pi1, const plot_info &pi2)
+{
+	QCOMPARE(pi1.nr, pi2.nr);
+	for (int i = 0; i < pi1.nr; i++) {
+		const plot_data &e1 = pi1.entry[i];
+		const plot_data &e2 = pi2.entry[i];
+		QCOMPARE(e1.ceiling, e2.ceiling);
+		QCOMPARE(e1.in_deco_calc, e2.in_deco_calc);
+		QCOMPARE(e1.ndl_calc, e2.ndl_calc);
+		QCOMPARE(e1.tts_calc, e2.tts_calc);
+		QCOMPARE(e1.stoptime_calc, e2.stoptime_calc);
+		QCOMPARE(e1.stopdepth_calc, e2.stopdepth_calc);
+		QCOMPARE(e1.gfline, e2.gfline);
+		QCOMPARE(e1.surface_gf, e2.surface_gf);
+		for (int j = 0; j < 16; j++)
+			QCOMPARE(get_plot_tissue_ceiling(pi1, i, j), get_plot_tissue_ceiling(pi2, i, j));
+	}
+}
+
+void TestProfile::testIncrementalDeco()
+{
+	prefs.planner_deco_mode = BUEHLMANN;
+	prefs.calcndltts = true;
+	divelog.clear();
+	parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &divelog);
+
+	// Take the longest dive, so that there are checkpoints to resume from
+	dive *d = nullptr;
+	for (auto &d2: divelog.dives) {
+		if (!d || d2->dcs[0].samples.size() > d->dcs[0].samples.size())
+			d = d2.get();
+	}
+	QVERIFY(d);
+	divecomputer *dc = &d->dcs[0];
+	plot_info previous = create_plot_info_new(d, dc, nullptr);
+	QVERIFY(previous.deco_checkpoints.size() > 1);
+
+	// Resuming after a late edit gives the same result as a fresh calculation
+	sample &s = dc->samples[dc->samples.size() * 3 / 4];
+	s.depth.mm += 3000;
+	plot_info incremental = create_plot_info_new(d, dc, nullptr, &previous);
+	plot_info fresh = create_plot_info_new(d, dc, nullptr);
+	compareDecoInformation(incremental, fresh);
+	s.depth.mm -= 3000;
+
+	// As do changes of the preferences that NDL and TTS depend on
+	prefs.units.length = units::FEET;
+	prefs.ascratelast6m /= 2;
+	prefs.decosac *= 2;
+	incremental = create_plot_info_new(d, dc, nullptr, &previous);
+	fresh = create_plot_info_new(d, dc, nullptr);
+	compareDecoInformation(incremental, fresh);
+}
+
+void TestProfile::testPlotInfoCache()
+{
+	prefs.planner_deco_mode = BUEHLMANN;
+	divelog.clear();
+	PlotInfoCache *cache = PlotInfoCache::instance();
+	cache->clear();
+	parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &divelog);
+	QVERIFY(divelog.dives.size() >= 3);
+	dive *first = divelog.dives[0].get();
+	dive *last = divelog.dives.back().get();
+
+	// Cached results must be the same as freshly calculated ones
+	for (auto &d: divelog.dives)
+		cache->get(d.get(), 0);
+	QCOMPARE(cache->count(), static_cast<int>(divelog.dives.size()));
+	plot_info cached = cache->get(last, 0);
+	plot_info fresh = create_plot_info_new(last, &last->dcs[0], nullptr);
+	QCOMPARE(cached.nr, fresh.nr);
+	for (int i = 0; i < fresh.nr; i++) {
+		QCOMPARE(cached.entry[i].sec, fresh.entry[i].sec);
+		QCOMPARE(cached.entry[i].ceiling, fresh.entry[i].ceiling);
+		QCOMPARE(cached.entry[i].ndl_calc, fresh.entry[i].ndl_calc);
+	}
+
+	// Changing a deco preference misses the cache
+	prefs.planner_deco_mode = VPMB;
+	QVERIFY(!cache->find(last, 0));
+	prefs.planner_deco_mode = BUEHLMANN;
+	QVERIFY(cache->find(last, 0));
+	prefs.ascratelast6m /= 2;
+	QVERIFY(!cache->find(last, 0));
+	prefs.ascratelast6m = default_prefs.ascratelast6m;
+	prefs.units.length = units::FEET;
+	QVERIFY(!cache->find(last, 0));
+	prefs.units.length = default_prefs.units.length;
+	QVERIFY(cache->find(last, 0));
+
+	// Changing a dive invalidates that dive and all following dives
+	emit diveListNotifier.divesChanged(QVector<dive *>{ last }, DiveField::DEPTH);
+	QVERIFY(!cache->find(last, 0));
+	QVERIFY(cache->find(first, 0));
+	emit diveListNotifier.eventsChanged(first);
+	QCOMPARE(cache->count(), 0);
+
+	// Only the most recently used entries are kept
+	for (auto &d: divelog.dives)
+		cache->get(d.get(), 0);
+	cache->setMaxSize(cache->size() / 2);
+	QVERIFY(cache->count() < static_cast<int>(divelog.dives.size()));
+	QVERIFY(cache->find(last, 0));
+	QVERIFY(!cache->find(first, 0));
+	cache->setMaxSize(128 * 1024 * 1024);
+	cache->clear();
+}
+
+static std::unique_ptr<dive> copy_with_new_id(const dive &d, timestamp_t when)
+{
+	auto res = std::make_unique<dive>();
+	copy_dive(&d, res.get());
+	res->id = dive_getUniqID();
+	res->when = when;
+	res->divetrip = nullptr;
+	res->dive_site = nullptr;
+	return res;
+}
+
+// A series of dives with the profile of the given dive, one hour apart
+static dive_table repetitive_dives(const dive &d, int count)
+{
+	dive_table res;
+	timestamp_t when = d.when;
+	for (int i = 0; i < count; i++) {
+		const dive *copy = res.put(copy_with_new_id(d, when)).ptr;
+		when = copy->endtime() + 3600;
+	}
+	return res;
+}
+
+// The same dives with new ids, so that init_decompression() can't find
+// their end-of-dive states in its cache
+static dive_table cold_copy(const dive_table &dives)
+{
+	dive_table res;
+	for (auto &d: dives)
+		res.put(copy_with_new_id(*d, d->when));
+	return res;
+}
+
+static void compareTissues(const deco_state &ds1, const deco_state &ds2)
+{
+	for (int i = 0; i < 16; i++) {
+		QCOMPARE(ds1.tissue_n2_sat[i], ds2.tissue_n2_sat[i]);
+		QCOMPARE(ds1.tissue_he_sat[i], ds2.tissue_he_sat[i]);
+		QCOMPARE(ds1.tolerated_by_tissue[i], ds2.tolerated_by_tissue[i]);
+	}
+	QCOMPARE(ds1.gf_low_pressure_this_dive, ds2.gf_low_pressure_this_dive);
+}
+
+void TestProfile::testEndOfDiveCache()
+{
+	prefs.planner_deco_mode = BUEHLMANN;
+	divelog.clear();
+	parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &divelog);
+	dive *d = nullptr;
+	for (auto &d2: divelog.dives) {
+		if (!d || d2->dcs[0].samples.size() > d->dcs[0].samples.size())
+			d = d2.get();
+	}
+	QVERIFY(d);
+
+	// Fill the cache with the end-of-dive states of the first two dives
+	dive_table dives = repetitive_dives(*d, 3);
+	const dive *last = dives.back().get();
+	deco_state cached;
+	dives.init_decompression(&cached, last, false);
+
+	// Editing the first dive must not give the cached states of the
+	// dives after it, but the same tissues as a cold calculation
+	for (sample &s: dives[0]->dcs[0].samples)
+		s.depth.mm += 3000;
+	deco_state edited;
+	dives.init_decompression(&edited, last, false);
+	QVERIFY(!std::equal(std::begin(edited.tissue_n2_sat), std::end(edited.tissue_n2_sat), std::begin(cached.tissue_n2_sat)));
+	dive_table cold_dives = cold_copy(dives);
+	deco_state cold;
+	cold_dives.init_decompression(&cold, cold_dives.back().get(), false);
+	compareTissues(edited, cold);
+
+	// Likewise after changing the gradient factors
+	deco_state gf_changed;
+	gf_changed.settings.set_gf(50, 90);
+	dives.init_decompression(&gf_changed, last, false);
+	QVERIFY(!std::equal(std::begin(gf_changed.tolerated_by_tissue), std::end(gf_changed.tolerated_by_tissue),
+			    std::begin(edited.tolerated_by_tissue)));
+	cold_dives = cold_copy(dives);
+	cold = deco_state();
+	cold.settings.set_gf(50, 90);
+	cold_dives.init_decompression(&cold, cold_dives.back().get(), false);
+	compareTissues(gf_changed, cold);
+}
+
 QTEST_GUILESS_MAIN(TestProfile)
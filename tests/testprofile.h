@@ -11,6 +11,9 @@ private slots:
 	void init();
 	void testProfileExport();
 	void testProfileExportVPMB();
+	void testIncrementalDeco();
+	void testPlotInfoCache();
+	void testEndOfDiveCache();
 };
 
 #endif
@@ -37,6 +37,10 @@ void TestQPrefDivePlanner::test_struct_get()
 	prefs.display_runtime = true;
 	prefs.display_transitions = true;
 	prefs.display_variations = true;
+	prefs.variations_depth_steps = 2;
+	prefs.variations_time_steps = 3;
+	prefs.variations_gf_steps = 1;
+	prefs.variations_table = true;
 	prefs.doo2breaks = true;
 	prefs.drop_stone_mode = true;
 	prefs.last_stop = true;
@@ -63,6 +67,10 @@ void TestQPrefDivePlanner::test_struct_get()
 	QCOMPARE(tst->display_runtime(), prefs.display_runtime);
 	QCOMPARE(tst->display_transitions(), prefs.display_transitions);
 	QCOMPARE(tst->display_variations(), prefs.display_variations);
+	QCOMPARE(tst->variations_depth_steps(), prefs.variations_depth_steps);
+	QCOMPARE(tst->variations_time_steps(), prefs.variations_time_steps);
+	QCOMPARE(tst->variations_gf_steps(), prefs.variations_gf_steps);
+	QCOMPARE(tst->variations_table(), prefs.variations_table);
 	QCOMPARE(tst->doo2breaks(), prefs.doo2breaks);
 	QCOMPARE(tst->drop_stone_mode(), prefs.drop_stone_mode);
 	QCOMPARE(tst->last_stop(), prefs.last_stop);
@@ -96,6 +104,10 @@ void TestQPrefDivePlanner::test_set_struct()
 	tst->set_display_runtime(false);
 	tst->set_display_transitions(false);
 	tst->set_display_variations(false);
+	tst->set_variations_depth_steps(3);
+	tst->set_variations_time_steps(4);
+	tst->set_variations_gf_steps(2);
+	tst->set_variations_table(false);
 	tst->set_doo2breaks(false);
 	tst->set_drop_stone_mode(false);
 	tst->set_last_stop(false);
@@ -122,6 +134,10 @@ void TestQPrefDivePlanner::test_set_struct()
 	QCOMPARE(prefs.display_runtime, false);
 	QCOMPARE(prefs.display_transitions, false);
 	QCOMPARE(prefs.display_variations, false);
+	QCOMPARE(prefs.variations_depth_steps, 3);
+	QCOMPARE(prefs.variations_time_steps, 4);
+	QCOMPARE(prefs.variations_gf_steps, 2);
+	QCOMPARE(prefs.variations_table, false);
 	QCOMPARE(prefs.doo2breaks, false);
 	QCOMPARE(prefs.drop_stone_mode, false);
 	QCOMPARE(prefs.last_stop, false);
@@ -155,6 +171,10 @@ void TestQPrefDivePlanner::test_set_load_struct()
 	tst->set_display_runtime(true);
 	tst->set_display_transitions(true);
 	tst->set_display_variations(true);
+	tst->set_variations_depth_steps(3);
+	tst->set_variations_time_steps(4);
+	tst->set_variations_gf_steps(2);
+	tst->set_variations_table(true);
 	tst->set_doo2breaks(true);
 	tst->set_drop_stone_mode(true);
 	tst->set_last_stop(true);
@@ -181,6 +201,10 @@ void TestQPrefDivePlanner::test_set_load_struct()
 	prefs.display_runtime = false;
 	prefs.display_transitions = false;
 	prefs.display_variations = false;
+	prefs.variations_depth_steps = 1;
+	prefs.variations_time_steps = 1;
+	prefs.variations_gf_steps = 0;
+	prefs.variations_table = false;
 	prefs.doo2breaks = false;
 	prefs.drop_stone_mode = false;
 	prefs.last_stop = false;
@@ -208,6 +232,10 @@ void TestQPrefDivePlanner::test_set_load_struct()
 	QCOMPARE(prefs.display_runtime, true);
 	QCOMPARE(prefs.display_transitions, true);
 	QCOMPARE(prefs.display_variations, true);
+	QCOMPARE(prefs.variations_depth_steps, 3);
+	QCOMPARE(prefs.variations_time_steps, 4);
+	QCOMPARE(prefs.variations_gf_steps, 2);
+	QCOMPARE(prefs.variations_table, true);
 	QCOMPARE(prefs.doo2breaks, true);
 	QCOMPARE(prefs.drop_stone_mode, true);
 	QCOMPARE(prefs.last_stop, true);
@@ -241,6 +269,10 @@ void TestQPrefDivePlanner::test_struct_disk()
 	prefs.display_runtime = false;
 	prefs.display_transitions = false;
 	prefs.display_variations = false;
+	prefs.variations_depth_steps = 4;
+	prefs.variations_time_steps = 5;
+	prefs.variations_gf_steps = 3;
+	prefs.variations_table = false;
 	prefs.doo2breaks = false;
 	prefs.drop_stone_mode = false;
 	prefs.last_stop = false;
@@ -268,6 +300,10 @@ void TestQPrefDivePlanner::test_struct_disk()
 	prefs.display_runtime = true;
 	prefs.display_transitions = true;
 	prefs.display_variations = true;
+	prefs.variations_depth_steps = 1;
+	prefs.variations_time_steps = 1;
+	prefs.variations_gf_steps = 0;
+	prefs.variations_table = true;
 	prefs.doo2breaks = true;
 	prefs.drop_stone_mode = true;
 	prefs.last_stop = true;
@@ -295,6 +331,10 @@ void TestQPrefDivePlanner::test_struct_disk()
 	QCOMPARE(prefs.display_runtime, false);
 	QCOMPARE(prefs.display_transitions, false);
 	QCOMPARE(prefs.display_variations, false);
+	QCOMPARE(prefs.variations_depth_steps, 4);
+	QCOMPARE(prefs.variations_time_steps, 5);
+	QCOMPARE(prefs.variations_gf_steps, 3);
+	QCOMPARE(prefs.variations_table, false);
 	QCOMPARE(prefs.doo2breaks, false);
 	QCOMPARE(prefs.drop_stone_mode, false);
 	QCOMPARE(prefs.last_stop, false);
@@ -461,6 +501,10 @@ void TestQPrefDivePlanner::test_signals()
 	QSignalSpy spy23(qPrefDivePlanner::instance(), &qPrefDivePlanner::safetystopChanged);
 	QSignalSpy spy24(qPrefDivePlanner::instance(), &qPrefDivePlanner::switch_at_req_stopChanged);
 	QSignalSpy spy25(qPrefDivePlanner::instance(), &qPrefDivePlanner::verbatim_planChanged);
+	QSignalSpy spy26(qPrefDivePlanner::instance(), &qPrefDivePlanner::variations_depth_stepsChanged);
+	QSignalSpy spy27(qPrefDivePlanner::instance(), &qPrefDivePlanner::variations_time_stepsChanged);
+	QSignalSpy spy28(qPrefDivePlanner::instance(), &qPrefDivePlanner::variations_gf_stepsChanged);
+	QSignalSpy spy29(qPrefDivePlanner::instance(), &qPrefDivePlanner::variations_tableChanged);
 
 	qPrefDivePlanner::set_ascratelast6m(-20);
 	qPrefDivePlanner::set_ascratestops(-21);
@@ -497,6 +541,11 @@ void TestQPrefDivePlanner::test_signals()
 	qPrefDivePlanner::set_switch_at_req_stop(false);
 	prefs.verbatim_plan = true;
 	qPrefDivePlanner::set_verbatim_plan(false);
+	qPrefDivePlanner::set_variations_depth_steps(-33);
+	qPrefDivePlanner::set_variations_time_steps(-34);
+	qPrefDivePlanner::set_variations_gf_steps(-35);
+	prefs.variations_table = true;
+	qPrefDivePlanner::set_variations_table(false);
 
 	QCOMPARE(spy1.count(), 1);
 	QCOMPARE(spy2.count(), 1);
@@ -523,6 +572,10 @@ void TestQPrefDivePlanner::test_signals()
 	QCOMPARE(spy23.count(), 1);
 	QCOMPARE(spy24.count(), 1);
 	QCOMPARE(spy25.count(), 1);
+	QCOMPARE(spy26.count(), 1);
+	QCOMPARE(spy27.count(), 1);
+	QCOMPARE(spy28.count(), 1);
+	QCOMPARE(spy29.count(), 1);
 
 	QVERIFY(spy1.takeFirst().at(0).toInt() == -20);
 	QVERIFY(spy2.takeFirst().at(0).toInt() == -21);
@@ -549,6 +602,10 @@ void TestQPrefDivePlanner::test_signals()
 	QVERIFY(spy23.takeFirst().at(0).toBool() == false);
 	QVERIFY(spy24.takeFirst().at(0).toBool() == false);
 	QVERIFY(spy25.takeFirst().at(0).toBool() == false);
+	QVERIFY(spy26.takeFirst().at(0).toInt() == -33);
+	QVERIFY(spy27.takeFirst().at(0).toInt() == -34);
+	QVERIFY(spy28.takeFirst().at(0).toInt() == -35);
+	QVERIFY(spy29.takeFirst().at(0).toBool() == false);
 }
 
 
@@ -28,12 +28,14 @@ void TestQPrefLog::test_struct_get()
 	prefs.use_default_file = true;
 	prefs.show_average_depth = true;
 	prefs.extraEnvironmentalDefault = true;
+	prefs.git_binary_samples = true;
 
 	QCOMPARE(tst->default_filename(), QString::fromStdString(prefs.default_filename));
 	QCOMPARE(tst->default_file_behavior(), prefs.default_file_behavior);
 	QCOMPARE(tst->use_default_file(), prefs.use_default_file);
 	QCOMPARE(tst->show_average_depth(), prefs.show_average_depth);
 	QCOMPARE(tst->extraEnvironmentalDefault(), prefs.extraEnvironmentalDefault);
+	QCOMPARE(tst->git_binary_samples(), prefs.git_binary_samples);
 }
 
 void TestQPrefLog::test_set_struct()
@@ -47,12 +49,14 @@ void TestQPrefLog::test_set_struct()
 	tst->set_use_default_file(false);
 	tst->set_show_average_depth(false);
 	tst->set_extraEnvironmentalDefault(false);
+	tst->set_git_binary_samples(false);
 
 	QCOMPARE(QString::fromStdString(prefs.default_filename), QString("new base22"));
 	QCOMPARE(prefs.default_file_behavior, LOCAL_DEFAULT_FILE);
 	QCOMPARE(prefs.use_default_file, false);
 	QCOMPARE(prefs.show_average_depth, false);
 	QCOMPARE(prefs.extraEnvironmentalDefault, false);
+	QCOMPARE(prefs.git_binary_samples, false);
 }
 
 void TestQPrefLog::test_set_load_struct()
@@ -66,12 +70,14 @@ void TestQPrefLog::test_set_load_struct()
 	tst->set_use_default_file(true);
 	tst->set_show_average_depth(true);
 	tst->set_extraEnvironmentalDefault(true);
+	tst->set_git_binary_samples(true);
 
 	prefs.default_filename = "error";
 	prefs.default_file_behavior = UNDEFINED_DEFAULT_FILE;
 	prefs.use_default_file = false;
 	prefs.show_average_depth = false;
 	prefs.extraEnvironmentalDefault = false;
+	prefs.git_binary_samples = false;
 
 	tst->load();
 	QCOMPARE(QString::fromStdString(prefs.default_filename), QString("new base32"));
@@ -79,6 +85,7 @@ void TestQPrefLog::test_set_load_struct()
 	QCOMPARE(prefs.use_default_file, true);
 	QCOMPARE(prefs.show_average_depth, true);
 	QCOMPARE(prefs.extraEnvironmentalDefault, true);
+	QCOMPARE(prefs.git_binary_samples, true);
 }
 
 void TestQPrefLog::test_struct_disk()
@@ -24,11 +24,13 @@ void TestQPrefMedia::test_struct_get()
 	auto tst = qPrefMedia::instance();
 
 	prefs.auto_recalculate_thumbnails = true;
+	prefs.thumbnail_threads = 2;
 	prefs.extract_video_thumbnails = true;
 	prefs.extract_video_thumbnails_position = 15;
 	prefs.ffmpeg_executable = "new base16";
 
 	QCOMPARE(tst->auto_recalculate_thumbnails(), prefs.auto_recalculate_thumbnails);
+	QCOMPARE(tst->thumbnail_threads(), prefs.thumbnail_threads);
 	QCOMPARE(tst->extract_video_thumbnails(), prefs.extract_video_thumbnails);
 	QCOMPARE(tst->extract_video_thumbnails_position(), prefs.extract_video_thumbnails_position);
 	QCOMPARE(tst->ffmpeg_executable(), QString::fromStdString(prefs.ffmpeg_executable));
@@ -41,11 +43,13 @@ void TestQPrefMedia::test_set_struct()
 	auto tst = qPrefMedia::instance();
 
 	tst->set_auto_recalculate_thumbnails(false);
+	tst->set_thumbnail_threads(3);
 	tst->set_extract_video_thumbnails(false);
 	tst->set_extract_video_thumbnails_position(25);
 	tst->set_ffmpeg_executable("new base26");
 
 	QCOMPARE(prefs.auto_recalculate_thumbnails, false);
+	QCOMPARE(prefs.thumbnail_threads, 3);
 	QCOMPARE(prefs.extract_video_thumbnails, false);
 	QCOMPARE(prefs.extract_video_thumbnails_position, 25);
 	QCOMPARE(QString::fromStdString(prefs.ffmpeg_executable), QString("new base26"));
@@ -58,17 +62,20 @@ void TestQPrefMedia::test_set_load_struct()
 	auto tst = qPrefMedia::instance();
 
 	tst->set_auto_recalculate_thumbnails(true);
+	tst->set_thumbnail_threads(4);
 	tst->set_extract_video_thumbnails(true);
 	tst->set_extract_video_thumbnails_position(35);
 	tst->set_ffmpeg_executable("new base36");
 
 	prefs.auto_recalculate_thumbnails = false;
+	prefs.thumbnail_threads = 0;
 	prefs.extract_video_thumbnails = false;
 	prefs.extract_video_thumbnails_position = 15;
 	prefs.ffmpeg_executable = "error";
 
 	tst->load();
 	QCOMPARE(prefs.auto_recalculate_thumbnails, true);
+	QCOMPARE(prefs.thumbnail_threads, 4);
 	QCOMPARE(prefs.extract_video_thumbnails, true);
 	QCOMPARE(prefs.extract_video_thumbnails_position, 35);
 	QCOMPARE(QString::fromStdString(prefs.ffmpeg_executable), QString("new base36"));
@@ -81,18 +88,21 @@ void TestQPrefMedia::test_struct_disk()
 	auto tst = qPrefMedia::instance();
 
 	prefs.auto_recalculate_thumbnails = true;
+	prefs.thumbnail_threads = 5;
 	prefs.extract_video_thumbnails = true;
 	prefs.extract_video_thumbnails_position = 45;
 	prefs.ffmpeg_executable = "base46";
 
 	tst->sync();
 	prefs.auto_recalculate_thumbnails = false;
+	prefs.thumbnail_threads = 0;
 	prefs.extract_video_thumbnails = false;
 	prefs.extract_video_thumbnails_position = 15;
 	prefs.ffmpeg_executable = "error";
 
 	tst->load();
 	QCOMPARE(prefs.auto_recalculate_thumbnails, true);
+	QCOMPARE(prefs.thumbnail_threads, 5);
 	QCOMPARE(prefs.extract_video_thumbnails, true);
 	QCOMPARE(prefs.extract_video_thumbnails_position, 45);
 	QCOMPARE(QString::fromStdString(prefs.ffmpeg_executable), QString("base46"));
@@ -110,17 +120,22 @@ void TestQPrefMedia::test_signals()
 	QSignalSpy spy6(qPrefMedia::instance(), &qPrefMedia::extract_video_thumbnailsChanged);
 	QSignalSpy spy7(qPrefMedia::instance(), &qPrefMedia::extract_video_thumbnails_positionChanged);
 	QSignalSpy spy8(qPrefMedia::instance(), &qPrefMedia::ffmpeg_executableChanged);
+	QSignalSpy spy9(qPrefMedia::instance(), &qPrefMedia::thumbnail_threadsChanged);
 
 	prefs.auto_recalculate_thumbnails = true;
 	qPrefMedia::set_auto_recalculate_thumbnails(false);
+	prefs.thumbnail_threads = 0;
+	qPrefMedia::set_thumbnail_threads(6);
 
 	qPrefMedia::set_extract_video_thumbnails(false);
 	qPrefMedia::set_extract_video_thumbnails_position(25);
 	qPrefMedia::set_ffmpeg_executable("new base26");
 
 	QCOMPARE(spy1.count(), 1);
+	QCOMPARE(spy9.count(), 1);
 
 	QVERIFY(spy1.takeFirst().at(0).toBool() == false);
+	QVERIFY(spy9.takeFirst().at(0).toInt() == 6);
 
 	qPrefMedia::set_extract_video_thumbnails(false);
 	qPrefMedia::set_extract_video_thumbnails_position(25);
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testthumbnailstore.h"
+#include "core/qthelper.h"
+#include "core/thumbnailstore.h"
+
+#include <QTemporaryDir>
+
+static QByteArray key(int i)
+{
+	return thumbnailHash(QString("picture%1.jpg").arg(i));
+}
+
+static QByteArray value(int i, int size = 100)
+{
+	return QByteArray(size, static_cast<char>('a' + i % 26));
+}
+
+void TestThumbnailStore::testPutGet()
+{
+	QTemporaryDir dir;
+	ThumbnailStore store(dir.path());
+	QVERIFY(store.get(key(0)).isNull());
+	QVERIFY(!store.put("too short", value(0)));
+
+	for (int i = 0; i < 10; ++i)
+		QVERIFY(store.put(key(i), value(i)));
+	for (int i = 0; i < 10; ++i)
+		QCOMPARE(store.get(key(i)), value(i));
+
+	// Replacing appends a new record
+	qint64 mtime = 0;
+	QVERIFY(store.put(key(3), value(4, 50)));
+	QCOMPARE(store.get(key(3), &mtime), value(4, 50));
+	QVERIFY(mtime > 0);
+	QCOMPARE(store.count(), 10);
+	QVERIFY(store.usedSize() < store.dataSize());
+}
+
+void TestThumbnailStore::testReopen()
+{
+	QTemporaryDir dir;
+	{
+		ThumbnailStore store(dir.path());
+		for (int i = 0; i < 10; ++i)
+			store.put(key(i), value(i));
+		store.writeIndex();
+		// Appended after writing the index: must be found by scanning the data file
+		store.put(key(10), value(10));
+		store.put(key(0), value(1));
+	}
+	QFile::remove(dir.filePath("thumbnails.idx"));
+	{
+		// Without index: everything is found by scanning
+		ThumbnailStore store(dir.path());
+		QCOMPARE(store.count(), 11);
+		QCOMPARE(store.get(key(0)), value(1));
+		QCOMPARE(store.get(key(10)), value(10));
+		store.writeIndex();
+		QVERIFY(QFile::copy(dir.filePath("thumbnails.idx"), dir.filePath("old.idx")));
+		store.put(key(11), value(11));
+	}
+	// Simulate a crash after the last put(): the index doesn't cover the last record
+	QFile::remove(dir.filePath("thumbnails.idx"));
+	QVERIFY(QFile::rename(dir.filePath("old.idx"), dir.filePath("thumbnails.idx")));
+	ThumbnailStore store(dir.path());
+	QCOMPARE(store.count(), 12);
+	for (int i = 1; i < 12; ++i)
+		QCOMPARE(store.get(key(i)), value(i));
+}
+
+void TestThumbnailStore::testTruncatedRecord()
+{
+	QTemporaryDir dir;
+	qint64 size;
+	{
+		ThumbnailStore store(dir.path());
+		store.put(key(0), value(0));
+		store.put(key(1), value(1));
+		size = store.dataSize();
+	}
+	QFile::remove(dir.filePath("thumbnails.idx"));
+	QFile data(dir.filePath("thumbnails.dat"));
+	QVERIFY(data.resize(size - 10));
+
+	ThumbnailStore store(dir.path());
+	QCOMPARE(store.count(), 1);
+	QCOMPARE(store.get(key(0)), value(0));
+	QVERIFY(store.get(key(1)).isNull());
+	QVERIFY(store.put(key(1), value(1)));
+	QCOMPARE(store.get(key(1)), value(1));
+}
+
+void TestThumbnailStore::testStaleIndex()
+{
+	QTemporaryDir dir;
+	{
+		ThumbnailStore store(dir.path());
+		store.put(key(0), value(0));
+		store.put(key(1), value(1));
+	}
+
+	// Swap the two records, which have the same size. The index is still in
+	// bounds, but doesn't point to the right records anymore.
+	QFile data(dir.filePath("thumbnails.dat"));
+	QVERIFY(data.open(QIODevice::ReadWrite));
+	QByteArray content = data.readAll();
+	qint64 half = content.size() / 2;
+	QVERIFY(data.seek(0));
+	QCOMPARE(data.write(content.mid(half) + content.left(half)), content.size());
+	data.close();
+
+	ThumbnailStore store(dir.path());
+	QCOMPARE(store.count(), 2);
+	QCOMPARE(store.get(key(0)), value(0));
+	QCOMPARE(store.get(key(1)), value(1));
+}
+
+void TestThumbnailStore::testCompaction()
+{
+	QTemporaryDir dir;
+	qint64 oldSize;
+	{
+		ThumbnailStore store(dir.path());
+		// Overwrite the same thumbnails until most of the file is garbage
+		for (int round = 0; round < 10; ++round) {
+			for (int i = 0; i < 10; ++i)
+				store.put(key(i), value(i + round, 50000));
+		}
+		oldSize = store.dataSize();
+	}
+	ThumbnailStore store(dir.path());
+	QVERIFY(store.dataSize() < oldSize / 5);
+	QCOMPARE(store.dataSize(), store.usedSize());
+	for (int i = 0; i < 10; ++i)
+		QCOMPARE(store.get(key(i)), value(i + 9, 50000));
+}
+
+void TestThumbnailStore::testRemap()
+{
+	QTemporaryDir dir;
+	ThumbnailStore store(dir.path());
+	// Data handed out before the data file grew must stay valid,
+	// while the new records are mapped in further parts.
+	std::vector<QByteArray> old;
+	for (int i = 0; i < 200; ++i) {
+		QVERIFY(store.put(key(i), value(i, 100000)));
+		old.push_back(store.get(key(i)));
+	}
+	QVERIFY(store.dataSize() > 4 * 4 * 1024 * 1024);
+	for (int i = 0; i < 200; ++i) {
+		QCOMPARE(old[i], value(i, 100000));
+		QCOMPARE(store.get(key(i)), value(i, 100000));
+	}
+}
+
+QTEST_GUILESS_MAIN(TestThumbnailStore)
@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTTHUMBNAILSTORE_H
+#define TESTTHUMBNAILSTORE_H
+
+#include <QtTest>
+
+class TestThumbnailStore : public QObject {
+	Q_OBJECT
+private slots:
+	void testPutGet();
+	void testReopen();
+	void testTruncatedRecord();
+	void testStaleIndex();
+	void testCompaction();
+	void testRemap();
+};
+
+#endif